@@ -0,0 +1,320 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, Jamie M.
+#
+# All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+#
+# Generates the device payload header (message type enums, sizes and uplink encoders) and the
+# host decoder tables from the payload schema. Downlinks are decoded by the application handlers,
+# only their types and sizes are generated for the device.
+
+import argparse
+import sys
+
+import yaml
+
+FORMATS = {
+    # format: (size, C type, signed, big endian)
+    'u8': (1, 'uint8_t', False, False),
+    's8': (1, 'int8_t', True, False),
+    'u16le': (2, 'uint16_t', False, False),
+    'u16be': (2, 'uint16_t', False, True),
+    's16le': (2, 'int16_t', True, False),
+    's16be': (2, 'int16_t', True, True),
+    'u32le': (4, 'uint32_t', False, False),
+    'u32be': (4, 'uint32_t', False, True),
+}
+
+TAILS = ('records', 'compact_readings', 'multiple', 'select', 'bytes')
+
+COPYRIGHT = '''/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+/* Generated from {schema} by gen_payloads.py, do not edit */
+'''
+
+
+def fail(message):
+    sys.exit(f'gen_payloads.py: {message}')
+
+
+def load_schema(path):
+    with open(path, encoding='utf-8') as f:
+        schema = yaml.safe_load(f)
+
+    for key in ('version', 'compatible_since', 'uplinks', 'downlinks', 'device_command_ops'):
+        if key not in schema:
+            fail(f'missing "{key}" in schema')
+
+    if not 1 <= schema['compatible_since'] <= schema['version'] <= 255:
+        fail('invalid schema version')
+
+    records = schema.get('records', {})
+    groups = {'device_command_ops': schema['device_command_ops']}
+
+    for group in ('uplinks', 'downlinks', 'device_command_ops'):
+        names = set()
+
+        for message in schema[group]:
+            if message['name'] in names:
+                fail(f'duplicate {group} name "{message["name"]}"')
+
+            names.add(message['name'])
+            message.setdefault('fields', [])
+            optional = False
+
+            for field in message['fields']:
+                if field['format'] not in FORMATS:
+                    fail(f'invalid format "{field["format"]}" in {message["name"]}')
+
+                if 'since' in field:
+                    optional = True
+                elif optional:
+                    fail(f'field {field["name"]} in {message["name"]} must be optional')
+
+            tail = message.get('tail')
+
+            if tail is None:
+                continue
+
+            if tail['kind'] not in TAILS:
+                fail(f'invalid tail "{tail["kind"]}" in {message["name"]}')
+
+            if 'record' in tail and tail['record'] not in records:
+                fail(f'unknown record "{tail["record"]}" in {message["name"]}')
+
+            if tail['kind'] == 'select' and tail.get('types') not in groups:
+                fail(f'unknown select types in {message["name"]}')
+
+    return schema
+
+
+def fixed_size(message):
+    return sum(FORMATS[field['format']][0] for field in message['fields'])
+
+
+def put_bytes(field, offset):
+    size, c_type, _, big_endian = FORMATS[field['format']]
+    unsigned_type = c_type if c_type.startswith('u') else f'u{c_type}'
+    name = field['name']
+
+    if size == 1:
+        return [f'\tdata[{offset}] = (uint8_t){name};']
+
+    lines = []
+
+    for i in range(size):
+        shift = ((size - 1 - i) if big_endian else i) * 8
+        value = f'({unsigned_type}){name}'
+
+        if shift:
+            value = f'({value} >> {shift})'
+
+        lines.append(f'\tdata[{offset + i}] = (uint8_t){value};')
+
+    return lines
+
+
+def generate_device_header(schema, schema_name):
+    out = [COPYRIGHT.format(schema=schema_name)]
+    out.append('#ifndef APP_PAYLOADS_H')
+    out.append('#define APP_PAYLOADS_H')
+    out.append('')
+    out.append('#include <stdint.h>')
+    out.append('')
+    out.append('/* Payload schema version, sent in the startup message */')
+    out.append(f'#define PAYLOAD_SCHEMA_VERSION {schema["version"]}')
+    out.append('')
+
+    enums = (
+        ('lora_uplink_types', 'LORA_UPLINK_TYPE', schema['uplinks'], False,
+         'Type of application uplinks, first byte of the payload'),
+        ('lora_downlink_types', 'LORA_DOWNLINK_TYPE', schema['downlinks'], False,
+         'Type of application downlinks, first byte of the payload or of each multiple record'),
+        ('device_command_op_t', 'DEVICE_COMMAND_OP', schema['device_command_ops'], True,
+         'Operations of LORA_DOWNLINK_TYPE_DEVICE downlinks'),
+    )
+
+    for enum_name, prefix, messages, count, comment in enums:
+        out.append(f'/* {comment} */')
+        out.append(f'enum {enum_name} {{')
+
+        for message in messages:
+            out.append(f'\t{prefix}_{message["name"].upper()},')
+
+        if count:
+            out.append('')
+            out.append(f'\t{prefix}_COUNT,')
+
+        out.append('};')
+        out.append('')
+
+    out.append('/* Size of the fixed fields of each message (uplinks include the type) */')
+
+    for message in schema['uplinks']:
+        out.append(f'#define PAYLOAD_UPLINK_{message["name"].upper()}_SIZE '
+                   f'{fixed_size(message) + 1}')
+
+    for message in schema['downlinks']:
+        out.append(f'#define PAYLOAD_DOWNLINK_{message["name"].upper()}_SIZE '
+                   f'{fixed_size(message)}')
+
+    for message in schema['device_command_ops']:
+        out.append(f'#define PAYLOAD_DEVICE_COMMAND_OP_{message["name"].upper()}_SIZE '
+                   f'{fixed_size(message)}')
+
+    out.append('')
+
+    for message in schema['uplinks']:
+        name = message['name']
+        args = ''.join(f', {FORMATS[field["format"]][1]} {field["name"]}'
+                       for field in message['fields'])
+        description = ', '.join(f'{field["name"]} ({field["format"]})'
+                                for field in message['fields'])
+
+        if 'tail' in message:
+            description += (', ' if description else '') + \
+                f'followed by {message["tail"]["kind"].replace("_", " ")}'
+
+        out.append(f'/* Encode {name} uplink{": " + description if description else ""}, '
+                   'returns size */')
+        out.append(f'static inline uint8_t payload_uplink_{name}_encode(uint8_t *data{args})')
+        out.append('{')
+        out.append(f'\tdata[0] = LORA_UPLINK_TYPE_{name.upper()};')
+
+        offset = 1
+
+        for field in message['fields']:
+            out.extend(put_bytes(field, offset))
+            offset += FORMATS[field['format']][0]
+
+        out.append('')
+        out.append(f'\treturn PAYLOAD_UPLINK_{name.upper()}_SIZE;')
+        out.append('}')
+        out.append('')
+
+    out.append('#endif /* APP_PAYLOADS_H */')
+
+    return '\n'.join(out) + '\n'
+
+
+def c_fields(symbol, fields):
+    if not fields:
+        return []
+
+    out = [f'static const struct payload_field {symbol}_fields[] = {{']
+
+    for field in fields:
+        out.append(f'\t{{ "{field["name"]}", PAYLOAD_FORMAT_{field["format"].upper()}, '
+                   f'{field.get("since", 0)} }},')
+
+    out.append('};')
+    out.append('')
+
+    return out
+
+
+def c_type(symbol, message, type_id, subtypes=None):
+    tail = message.get('tail', {'kind': 'none'})
+    fields = f'{symbol}_fields' if message['fields'] else 'NULL'
+    record = f'&record_{tail["record"]}' if 'record' in tail else 'NULL'
+    out = [f'static const struct payload_type {symbol} = {{']
+    out.append(f'\t.id = {type_id},')
+    out.append(f'\t.name = "{message["name"]}",')
+    out.append(f'\t.fields = {fields},')
+    out.append(f'\t.field_count = {len(message["fields"])},')
+    out.append(f'\t.tail = PAYLOAD_TAIL_{tail["kind"].upper()},')
+    out.append(f'\t.record = {record},')
+
+    if subtypes is not None:
+        out.append(f'\t.subtypes = {subtypes},')
+        out.append(f'\t.subtype_count = ARRAY_SIZE({subtypes}),')
+
+    out.append('};')
+    out.append('')
+
+    return out
+
+
+def generate_host_tables(schema, schema_name):
+    out = [COPYRIGHT.format(schema=schema_name)]
+    out.append('#include <stddef.h>')
+    out.append('#include "payload_decoder.h"')
+    out.append('')
+    out.append('#ifndef ARRAY_SIZE')
+    out.append('#define ARRAY_SIZE(array) (sizeof(array) / sizeof((array)[0]))')
+    out.append('#endif')
+    out.append('')
+
+    for name, record in schema.get('records', {}).items():
+        record = dict(record, name=name)
+        record.setdefault('fields', [])
+        out.extend(c_fields(f'record_{name}', record['fields']))
+        out.extend(c_type(f'record_{name}', record, 0))
+
+    groups = (('device_command_ops', 'device_command_op'), ('uplinks', 'uplink'),
+              ('downlinks', 'downlink'))
+
+    for group, prefix in groups:
+        for type_id, message in enumerate(schema[group]):
+            symbol = f'{prefix}_{message["name"]}'
+            tail = message.get('tail', {})
+            subtypes = f'{tail["types"]}_table' if tail.get('kind') == 'select' else None
+
+            out.extend(c_fields(symbol, message['fields']))
+            out.extend(c_type(symbol, message, type_id, subtypes))
+
+        out.append(f'static const struct payload_type *const {group}_table[] = {{')
+
+        for message in schema[group]:
+            out.append(f'\t&{prefix}_{message["name"]},')
+
+        out.append('};')
+        out.append('')
+
+    out.append('const struct payload_schema payload_schema = {')
+    out.append(f'\t.version = {schema["version"]},')
+    out.append(f'\t.compatible_since = {schema["compatible_since"]},')
+    out.append('\t.uplinks = uplinks_table,')
+    out.append('\t.uplink_count = ARRAY_SIZE(uplinks_table),')
+    out.append('\t.downlinks = downlinks_table,')
+    out.append('\t.downlink_count = ARRAY_SIZE(downlinks_table),')
+    out.append('};')
+
+    return '\n'.join(out) + '\n'
+
+
+def write_if_changed(path, content):
+    try:
+        with open(path, encoding='utf-8') as f:
+            if f.read() == content:
+                return
+    except FileNotFoundError:
+        pass
+
+    with open(path, 'w', encoding='utf-8') as f:
+        f.write(content)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate uplink encoders and decoder tables')
+    parser.add_argument('--schema', required=True, help='payload schema (YAML)')
+    parser.add_argument('--device-header', help='output device header')
+    parser.add_argument('--host-tables', help='output host decoder tables')
+    args = parser.parse_args()
+
+    schema = load_schema(args.schema)
+    schema_name = args.schema.replace('\\', '/').split('/')[-1]
+
+    if args.device_header:
+        write_if_changed(args.device_header, generate_device_header(schema, schema_name))
+
+    if args.host_tables:
+        write_if_changed(args.host_tables, generate_host_tables(schema, schema_name))
+
+
+if __name__ == '__main__':
+    main()
@@ -8,6 +8,14 @@
 #include <zephyr/drivers/adc.h>
 #include <zephyr/logging/log.h>
 #include "adc.h"
+#include "energy.h"
+
+#ifdef CONFIG_ADC_EMUL
+#include <zephyr/drivers/adc/adc_emul.h>
+
+/* Supply voltage reported by the emulated ADC (native_sim) */
+#define ADC_EMUL_SUPPLY_MV 3000
+#endif
 
 LOG_MODULE_REGISTER(adc, CONFIG_APP_ADC_LOG_LEVEL);
 
@@ -45,6 +53,12 @@ int adc_setup()
 		LOG_ERR("ADC channel setup failed: %d", rc);
 	}
 
+#ifdef CONFIG_ADC_EMUL
+	if (rc == 0) {
+		rc = adc_emul_const_value_set(adc, 0, ADC_EMUL_SUPPLY_MV);
+	}
+#endif
+
 	return rc;
 }
 
@@ -62,7 +76,9 @@ int adc_read_internal(uint16_t *voltage)
 		.resolution = 10,
 	};
 
+	energy_start(ENERGY_CONSUMER_ADC);
 	rc = adc_read(adc, &adc_sequence);
+	energy_stop(ENERGY_CONSUMER_ADC);
 
 	if (rc != 0) {
 		LOG_ERR("ADC reading failed: %d", rc);
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "airtime.h"
+#include "energy.h"
+
+/* Time on air is also used for energy accounting, budgets only exist with airtime accounting */
+#ifdef CONFIG_APP_LORA_AIRTIME
+LOG_MODULE_REGISTER(airtime, CONFIG_APP_LORA_AIRTIME_LOG_LEVEL);
+#endif
+
+/* LoRaWAN overhead: MHDR (1), FHDR (7), FPort (1) and MIC (4) */
+#define LORAWAN_OVERHEAD_SIZE 13
+#define PREAMBLE_SYMBOLS_X4 49
+#define CODING_RATE 1
+#define LOW_DATARATE_OPTIMISE_SF 11
+
+/* Rolling windows: 6 buckets of 10 minutes for the hour, 24 buckets of 1 hour for the day */
+#define HOUR_BUCKETS 6
+#define HOUR_BUCKET_MS (10 * 60 * MSEC_PER_SEC)
+#define DAY_BUCKETS 24
+#define DAY_BUCKET_MS (60 * 60 * MSEC_PER_SEC)
+
+struct datarate_t {
+	uint8_t sf;
+	uint16_t bw_khz;
+};
+
+/* EU868 datarates */
+static const struct datarate_t datarates[] = {
+	{ 12, 125 },
+	{ 11, 125 },
+	{ 10, 125 },
+	{ 9, 125 },
+	{ 8, 125 },
+	{ 7, 125 },
+	{ 7, 250 },
+};
+
+#ifdef CONFIG_APP_LORA_AIRTIME
+struct airtime_buckets_t {
+	/* Airtime per bucket, in us */
+	uint32_t hour[HOUR_BUCKETS];
+	uint32_t day[DAY_BUCKETS];
+};
+
+/* Percentage of the budget that each traffic class can use before it is deferred or shed */
+static const uint8_t class_limit_percent[LORA_TRAFFIC_CLASS_COUNT] = {
+	[LORA_TRAFFIC_CLASS_READINGS] = 100,
+	[LORA_TRAFFIC_CLASS_ACK] = 100,
+	[LORA_TRAFFIC_CLASS_SMP] = CONFIG_APP_LORA_AIRTIME_SMP_PERCENT,
+};
+
+static struct airtime_buckets_t buckets[LORA_TRAFFIC_CLASS_COUNT];
+static int64_t hour_bucket = 0;
+static int64_t day_bucket = 0;
+static struct k_spinlock airtime_lock;
+#endif
+
+uint32_t airtime_get_time_on_air(uint8_t payload_size)
+{
+	uint8_t current_datarate = lora_get_datarate();
+	const struct datarate_t *datarate;
+
+	if (current_datarate >= ARRAY_SIZE(datarates)) {
+		/* Unknown datarate, use the slowest so that airtime is not under counted */
+		current_datarate = 0;
+	}
+
+	datarate = &datarates[current_datarate];
+	uint32_t symbol_time_us = ((uint32_t)1 << datarate->sf) * 1000 / datarate->bw_khz;
+	uint8_t low_datarate_optimise = (datarate->sf >= LOW_DATARATE_OPTIMISE_SF &&
+					 datarate->bw_khz == 125) ? 1 : 0;
+	int32_t numerator = 8 * (payload_size + LORAWAN_OVERHEAD_SIZE) - 4 * datarate->sf + 28 + 16;
+	int32_t denominator = 4 * (datarate->sf - 2 * low_datarate_optimise);
+	uint32_t payload_symbols = 8;
+
+	/* Explicit header and CRC enabled */
+	if (numerator > 0) {
+		payload_symbols += DIV_ROUND_UP(numerator, denominator) * (CODING_RATE + 4);
+	}
+
+	return (symbol_time_us * PREAMBLE_SYMBOLS_X4 / 4) + (payload_symbols * symbol_time_us);
+}
+
+#ifdef CONFIG_APP_LORA_AIRTIME
+/* Must be called with the lock held */
+static void airtime_advance(void)
+{
+	int64_t now = k_uptime_get();
+	int64_t hour_now = now / HOUR_BUCKET_MS;
+	int64_t day_now = now / DAY_BUCKET_MS;
+	uint8_t i;
+
+	if ((hour_now - hour_bucket) > HOUR_BUCKETS) {
+		hour_bucket = hour_now - HOUR_BUCKETS;
+	}
+
+	if ((day_now - day_bucket) > DAY_BUCKETS) {
+		day_bucket = day_now - DAY_BUCKETS;
+	}
+
+	/* Clear buckets which have expired */
+	while (hour_bucket < hour_now) {
+		++hour_bucket;
+
+		for (i = 0; i < LORA_TRAFFIC_CLASS_COUNT; ++i) {
+			buckets[i].hour[hour_bucket % HOUR_BUCKETS] = 0;
+		}
+	}
+
+	while (day_bucket < day_now) {
+		++day_bucket;
+
+		for (i = 0; i < LORA_TRAFFIC_CLASS_COUNT; ++i) {
+			buckets[i].day[day_bucket % DAY_BUCKETS] = 0;
+		}
+	}
+}
+
+/* Must be called with the lock held, sets hour and day in us */
+static void airtime_sum(enum lora_traffic_class_t traffic_class, uint64_t *hour, uint64_t *day)
+{
+	uint8_t i;
+
+	*hour = 0;
+	*day = 0;
+
+	for (i = 0; i < HOUR_BUCKETS; ++i) {
+		*hour += buckets[traffic_class].hour[i];
+	}
+
+	for (i = 0; i < DAY_BUCKETS; ++i) {
+		*day += buckets[traffic_class].day[i];
+	}
+}
+
+bool airtime_allowed(enum lora_traffic_class_t traffic_class, uint8_t payload_size)
+{
+	uint64_t hour = 0;
+	uint64_t day = 0;
+	uint64_t class_hour;
+	uint64_t class_day;
+	uint32_t time_on_air = airtime_get_time_on_air(payload_size);
+	uint8_t i;
+	k_spinlock_key_t key;
+
+	if (traffic_class >= LORA_TRAFFIC_CLASS_COUNT) {
+		return false;
+	}
+
+	key = k_spin_lock(&airtime_lock);
+	airtime_advance();
+
+	/* Budget is shared by all traffic classes */
+	for (i = 0; i < LORA_TRAFFIC_CLASS_COUNT; ++i) {
+		airtime_sum(i, &class_hour, &class_day);
+		hour += class_hour;
+		day += class_day;
+	}
+
+	k_spin_unlock(&airtime_lock, key);
+
+	hour += time_on_air;
+	day += time_on_air;
+
+	if (hour > ((uint64_t)CONFIG_APP_LORA_AIRTIME_HOUR_BUDGET * USEC_PER_MSEC *
+		    class_limit_percent[traffic_class] / 100)) {
+		LOG_WRN("Hourly airtime budget reached for traffic class %d", traffic_class);
+		return false;
+	}
+
+	if (CONFIG_APP_LORA_AIRTIME_DAY_BUDGET > 0 &&
+	    day > ((uint64_t)CONFIG_APP_LORA_AIRTIME_DAY_BUDGET * USEC_PER_MSEC *
+		   class_limit_percent[traffic_class] / 100)) {
+		LOG_WRN("Daily airtime budget reached for traffic class %d", traffic_class);
+		return false;
+	}
+
+	return true;
+}
+
+void airtime_record(enum lora_traffic_class_t traffic_class, uint8_t payload_size)
+{
+	uint32_t time_on_air = airtime_get_time_on_air(payload_size);
+	k_spinlock_key_t key;
+
+	if (traffic_class >= LORA_TRAFFIC_CLASS_COUNT) {
+		return;
+	}
+
+	key = k_spin_lock(&airtime_lock);
+	airtime_advance();
+	buckets[traffic_class].hour[hour_bucket % HOUR_BUCKETS] += time_on_air;
+	buckets[traffic_class].day[day_bucket % DAY_BUCKETS] += time_on_air;
+	k_spin_unlock(&airtime_lock, key);
+}
+
+void airtime_get_usage(enum lora_traffic_class_t traffic_class, struct airtime_usage_t *usage)
+{
+	uint64_t hour;
+	uint64_t day;
+	k_spinlock_key_t key = k_spin_lock(&airtime_lock);
+
+	airtime_advance();
+	airtime_sum(traffic_class, &hour, &day);
+	k_spin_unlock(&airtime_lock, key);
+
+	usage->hour = hour / USEC_PER_MSEC;
+	usage->day = day / USEC_PER_MSEC;
+}
+#endif /* CONFIG_APP_LORA_AIRTIME */
+
+#ifdef CONFIG_APP_ENERGY
+void airtime_energy_record(uint8_t payload_size)
+{
+	/* Radio time is not visible from the stack, estimate it from the time on air and the
+	 * receive windows which follow each uplink
+	 */
+	energy_add(ENERGY_CONSUMER_RADIO_TX, airtime_get_time_on_air(payload_size));
+	energy_add(ENERGY_CONSUMER_RADIO_RX,
+		   (CONFIG_APP_ENERGY_RADIO_RX_WINDOW_TIME * USEC_PER_MSEC));
+}
+#endif
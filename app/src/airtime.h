@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_AIRTIME_H
+#define APP_AIRTIME_H
+
+#include <zephyr/kernel.h>
+#include "lora.h"
+
+struct airtime_usage_t {
+	/* Airtime used in the last hour, in ms */
+	uint32_t hour;
+	/* Airtime used in the last day, in ms */
+	uint32_t day;
+};
+
+/* Get time on air (in us) of an uplink with the specified application payload size at the
+ * current datarate
+ */
+uint32_t airtime_get_time_on_air(uint8_t payload_size);
+
+/* Check if an uplink of the specified traffic class and size can be sent without exceeding the
+ * budget for that class
+ */
+bool airtime_allowed(enum lora_traffic_class_t traffic_class, uint8_t payload_size);
+
+/* Record an uplink of the specified traffic class and size */
+void airtime_record(enum lora_traffic_class_t traffic_class, uint8_t payload_size);
+
+/* Get airtime usage of a traffic class */
+void airtime_get_usage(enum lora_traffic_class_t traffic_class, struct airtime_usage_t *usage);
+
+#ifdef CONFIG_APP_ENERGY
+/* Add the radio time of an uplink (sent or attempted) with the specified payload size to energy
+ * accounting
+ */
+void airtime_energy_record(uint8_t payload_size);
+#endif
+
+#endif /* APP_AIRTIME_H */
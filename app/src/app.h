@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_APP_H
+#define APP_APP_H
+
+#include <zephyr/kernel.h>
+
+struct app_status_t {
+	bool readings_enabled;
+	/* Time between sensor readings, in seconds */
+	uint16_t sensor_reading_time;
+};
+
+/* Enable or disable fetching readings, the reading schedule keeps running whilst disabled */
+void app_readings_enable(bool enable);
+
+/* Get application status */
+void app_get_status(struct app_status_t *status);
+
+#ifdef CONFIG_APP_SUSPEND
+/* Suspend sampling once the main loop is idle, until wake_time (in seconds) has elapsed or the
+ * button is pressed, 0 enters System OFF (the device resets when woken by the button)
+ */
+void app_suspend(uint32_t wake_time);
+#endif
+
+#endif /* APP_APP_H */
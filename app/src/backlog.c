@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/fs/nvs.h>
+#include <zephyr/settings/settings.h>
+#include "backlog.h"
+#include "flash_maintenance.h"
+
+LOG_MODULE_REGISTER(backlog, CONFIG_APP_READINGS_BACKLOG_LOG_LEVEL);
+
+/* NVS IDs used by the backlog, settings uses IDs from 0x8000 upwards */
+#define BACKLOG_ID_META 0x1000
+#define BACKLOG_ID_RECORD_BASE 0x1001
+
+BUILD_ASSERT((BACKLOG_ID_RECORD_BASE + CONFIG_APP_READINGS_BACKLOG_RECORDS) < 0x8000,
+	     "Backlog NVS IDs overlap settings NVS IDs");
+
+struct backlog_meta_t {
+	/* Index of the oldest record */
+	uint16_t head;
+	/* Number of records */
+	uint16_t count;
+	/* Backlog clock when the metadata was written */
+	uint32_t clock;
+};
+
+struct backlog_record_t {
+	/* Backlog clock when the newest reading was taken */
+	uint32_t time;
+	/* Time between readings (in seconds), all readings in a record are this far apart */
+	uint16_t interval;
+	struct reading_t readings[CONFIG_APP_READINGS_BACKLOG_BATCH];
+};
+
+#define BACKLOG_RECORD_HEADER_SIZE offsetof(struct backlog_record_t, readings)
+
+/* Difference from the interval (in seconds) allowed between readings in the same record, covers
+ * sample jitter and rounding of the uptime to seconds
+ */
+#define BACKLOG_INTERVAL_TOLERANCE (CONFIG_APP_SAMPLE_JITTER + 1)
+
+static struct nvs_fs *backlog_fs = NULL;
+static struct backlog_meta_t backlog_meta = { 0 };
+static struct backlog_record_t staged;
+static uint8_t staged_count = 0;
+
+/* Backlog clock is seconds of uptime which carries on from the previous boot, so that ages of
+ * records stored before a reboot are still known. Time between the last metadata write and a
+ * reset, and whilst the device is off, is not counted
+ */
+static uint32_t clock_base = 0;
+
+static uint32_t backlog_clock(uint32_t uptime)
+{
+	return clock_base + uptime;
+}
+
+int backlog_init(void)
+{
+	int rc;
+
+	rc = settings_storage_get((void **)&backlog_fs);
+
+	if (rc != 0 || backlog_fs == NULL) {
+		LOG_ERR("Settings storage get failed: %d", rc);
+		backlog_fs = NULL;
+		return (rc != 0 ? rc : -ENOENT);
+	}
+
+	rc = nvs_read(backlog_fs, BACKLOG_ID_META, &backlog_meta, sizeof(backlog_meta));
+
+	if (rc != sizeof(backlog_meta) || backlog_meta.head >= CONFIG_APP_READINGS_BACKLOG_RECORDS ||
+	    backlog_meta.count > CONFIG_APP_READINGS_BACKLOG_RECORDS) {
+		/* No backlog */
+		backlog_meta.head = 0;
+		backlog_meta.count = 0;
+		backlog_meta.clock = 0;
+	} else if (backlog_meta.count > 0) {
+		LOG_INF("%d backlog records pending", backlog_meta.count);
+	}
+
+	clock_base = backlog_meta.clock;
+
+	return 0;
+}
+
+static int backlog_write_meta(void)
+{
+	int rc;
+
+	backlog_meta.clock = backlog_clock((uint32_t)(k_uptime_get() / MSEC_PER_SEC));
+	flash_maintenance_write_start();
+	rc = nvs_write(backlog_fs, BACKLOG_ID_META, &backlog_meta, sizeof(backlog_meta));
+	/* Unchanged data is not written again */
+	flash_maintenance_write_end(rc > 0 ? sizeof(backlog_meta) : 0);
+
+	return (rc < 0 ? rc : 0);
+}
+
+int backlog_flush(void)
+{
+	int rc;
+	uint16_t index;
+	size_t size;
+
+	if (staged_count == 0) {
+		return 0;
+	} else if (backlog_fs == NULL) {
+		return -ENOENT;
+	}
+
+	if (backlog_meta.count == CONFIG_APP_READINGS_BACKLOG_RECORDS) {
+		/* Backlog full, overwrite oldest record */
+		LOG_WRN("Backlog full, dropping oldest record");
+		backlog_meta.head = (backlog_meta.head + 1) % CONFIG_APP_READINGS_BACKLOG_RECORDS;
+		--backlog_meta.count;
+	}
+
+	index = (backlog_meta.head + backlog_meta.count) % CONFIG_APP_READINGS_BACKLOG_RECORDS;
+	size = BACKLOG_RECORD_HEADER_SIZE + staged_count * sizeof(staged.readings[0]);
+	flash_maintenance_write_start();
+	rc = nvs_write(backlog_fs, (BACKLOG_ID_RECORD_BASE + index), &staged, size);
+	flash_maintenance_write_end(rc > 0 ? size : 0);
+
+	if (rc < 0) {
+		LOG_ERR("Backlog record write failed: %d", rc);
+		return rc;
+	}
+
+	++backlog_meta.count;
+	staged_count = 0;
+
+	return backlog_write_meta();
+}
+
+/* Check if a reading taken at time (backlog clock) with interval follows on from the staged
+ * readings, so that it can be added to the same record
+ */
+static bool backlog_follows(uint32_t time, uint16_t interval)
+{
+	uint32_t delta = time - staged.time;
+
+	return (interval == staged.interval && time >= staged.time &&
+		(delta + BACKLOG_INTERVAL_TOLERANCE) >= interval &&
+		delta <= (interval + BACKLOG_INTERVAL_TOLERANCE));
+}
+
+void backlog_add(const struct reading_t *reading, uint32_t time, uint16_t interval)
+{
+	time = backlog_clock(time);
+
+	if (staged_count > 0 && backlog_follows(time, interval) == false) {
+		/* Readings were skipped (e.g. sent or not reported) or the interval changed, the
+		 * staged readings must be closed as a record so that their times are kept
+		 */
+		(void)backlog_flush();
+
+		if (staged_count > 0) {
+			LOG_ERR("Dropping %d staged readings", staged_count);
+			staged_count = 0;
+		}
+	} else if (staged_count == CONFIG_APP_READINGS_BACKLOG_BATCH) {
+		/* Record has not been written by the idle path yet */
+		(void)backlog_flush();
+
+		if (staged_count == CONFIG_APP_READINGS_BACKLOG_BATCH) {
+			/* Write failed, drop oldest staged reading so new readings can be held */
+			memmove(&staged.readings[0], &staged.readings[1],
+				(sizeof(staged.readings) - sizeof(staged.readings[0])));
+			--staged_count;
+		}
+	}
+
+	memcpy(&staged.readings[staged_count], reading, sizeof(staged.readings[0]));
+	staged.time = time;
+	staged.interval = interval;
+	++staged_count;
+}
+
+void backlog_idle(void)
+{
+	if (staged_count == CONFIG_APP_READINGS_BACKLOG_BATCH) {
+		(void)backlog_flush();
+	}
+}
+
+bool backlog_pending(void)
+{
+	return (backlog_meta.count > 0);
+}
+
+int backlog_get(struct reading_t *readings, uint8_t max_count, uint8_t *count, uint32_t *age,
+		uint16_t *interval)
+{
+	struct backlog_record_t record;
+	uint32_t now;
+	size_t size;
+	int rc;
+
+	if (backlog_fs == NULL) {
+		return -ENOENT;
+	} else if (backlog_meta.count == 0) {
+		return -ENODATA;
+	}
+
+	rc = nvs_read(backlog_fs, (BACKLOG_ID_RECORD_BASE + backlog_meta.head), &record,
+		      sizeof(record));
+
+	if (rc < 0) {
+		LOG_ERR("Backlog record read failed: %d", rc);
+		return rc;
+	}
+
+	size = MIN((size_t)rc, sizeof(record));
+
+	if (size < (BACKLOG_RECORD_HEADER_SIZE + sizeof(record.readings[0]))) {
+		LOG_ERR("Backlog record invalid size: %d", rc);
+		return -EINVAL;
+	}
+
+	*count = MIN(((size - BACKLOG_RECORD_HEADER_SIZE) / sizeof(record.readings[0])), max_count);
+	memcpy(readings, record.readings, (*count * sizeof(readings[0])));
+
+	now = backlog_clock((uint32_t)(k_uptime_get() / MSEC_PER_SEC));
+	*age = (now > record.time ? (now - record.time) : 0);
+	*interval = record.interval;
+
+	return 0;
+}
+
+int backlog_remove(void)
+{
+	if (backlog_fs == NULL) {
+		return -ENOENT;
+	} else if (backlog_meta.count == 0) {
+		return -ENODATA;
+	}
+
+	flash_maintenance_write_start();
+	(void)nvs_delete(backlog_fs, (BACKLOG_ID_RECORD_BASE + backlog_meta.head));
+	flash_maintenance_write_end(0);
+	backlog_meta.head = (backlog_meta.head + 1) % CONFIG_APP_READINGS_BACKLOG_RECORDS;
+	--backlog_meta.count;
+
+	return backlog_write_meta();
+}
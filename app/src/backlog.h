@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_BACKLOG_H
+#define APP_BACKLOG_H
+
+#include <zephyr/kernel.h>
+#include "readings.h"
+
+/* Setup backlog, must be called after settings have been initialised */
+int backlog_init(void);
+
+/* Add an unsent reading taken at time (uptime in seconds) with the reading interval then in use
+ * to the backlog, readings are held in RAM and written to flash by backlog_idle() once a full
+ * record has been collected. A reading which is not one interval after the previous reading
+ * starts a new record, writing the previous one
+ */
+void backlog_add(const struct reading_t *reading, uint32_t time, uint16_t interval);
+
+/* Write any readings held in RAM to flash, e.g. before rebooting */
+int backlog_flush(void);
+
+/* Write a full record of readings held in RAM to flash, called when the device is idle */
+void backlog_idle(void);
+
+/* Check if there are any readings in the backlog on flash */
+bool backlog_pending(void);
+
+/* Read the oldest record of readings from the backlog, age is set to the time (in seconds) since
+ * the newest reading in the record was taken, time whilst the device was off is not counted, and
+ * interval to the time (in seconds) between the readings in the record
+ */
+int backlog_get(struct reading_t *readings, uint8_t max_count, uint8_t *count, uint32_t *age,
+		uint16_t *interval);
+
+/* Remove the oldest record of readings from the backlog, after it has been sent */
+int backlog_remove(void);
+
+#endif /* APP_BACKLOG_H */
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "backoff.h"
+
+LOG_MODULE_REGISTER(backoff, CONFIG_APP_BACKOFF_LOG_LEVEL);
+
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME 16777619U
+
+static uint32_t backoff_state = FNV_OFFSET_BASIS;
+static struct k_spinlock backoff_lock;
+
+/* Must be called with the lock held */
+static uint32_t backoff_random(void)
+{
+	/* xorshift32, only used to spread retries so does not need to be secure */
+	backoff_state ^= backoff_state << 13;
+	backoff_state ^= backoff_state >> 17;
+	backoff_state ^= backoff_state << 5;
+
+	return backoff_state;
+}
+
+void backoff_seed(const uint8_t *data, size_t size)
+{
+	k_spinlock_key_t key = k_spin_lock(&backoff_lock);
+	uint32_t hash = FNV_OFFSET_BASIS;
+	size_t i = 0;
+
+	/* FNV-1a hash of the device data, mixed with the cycle counter */
+	while (i < size) {
+		hash ^= data[i];
+		hash *= FNV_PRIME;
+		++i;
+	}
+
+	backoff_state = hash ^ k_cycle_get_32();
+
+	if (backoff_state == 0) {
+		backoff_state = FNV_OFFSET_BASIS;
+	}
+
+	k_spin_unlock(&backoff_lock, key);
+}
+
+uint32_t backoff_next(struct backoff_t *backoff)
+{
+	k_spinlock_key_t key = k_spin_lock(&backoff_lock);
+	uint64_t upper = (uint64_t)backoff->delay_ms * 3;
+	uint32_t delay;
+
+	if (upper > backoff->cap_ms) {
+		upper = backoff->cap_ms;
+	}
+
+	if (upper <= backoff->base_ms) {
+		delay = backoff->base_ms;
+	} else {
+		delay = backoff->base_ms + (backoff_random() % (uint32_t)(upper - backoff->base_ms + 1));
+	}
+
+	backoff->delay_ms = delay;
+	k_spin_unlock(&backoff_lock, key);
+
+	return delay;
+}
+
+void backoff_sleep(struct backoff_t *backoff)
+{
+	uint32_t delay = backoff_next(backoff);
+
+	LOG_DBG("Retrying in %dms", delay);
+	k_sleep(K_MSEC(delay));
+}
+
+int backoff_sleep_until(struct backoff_t *backoff, int64_t deadline)
+{
+	uint32_t delay = backoff_next(backoff);
+
+	backoff->retry_time = k_uptime_get() + delay;
+
+	if (backoff->retry_time > deadline) {
+		LOG_DBG("Retry in %ums is past deadline", delay);
+		return -ETIMEDOUT;
+	}
+
+	LOG_DBG("Retrying in %ums", delay);
+	k_sleep(K_MSEC(delay));
+
+	return 0;
+}
+
+bool backoff_ready(const struct backoff_t *backoff)
+{
+	return (k_uptime_get() >= backoff->retry_time);
+}
+
+void backoff_reset(struct backoff_t *backoff)
+{
+	backoff->delay_ms = backoff->base_ms;
+	backoff->retry_time = 0;
+}
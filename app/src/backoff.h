@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_BACKOFF_H
+#define APP_BACKOFF_H
+
+#include <zephyr/kernel.h>
+
+/*
+ * Retry backoff with decorrelated jitter: each delay is a random value between the base and 3
+ * times the previous delay, limited to the cap. This grows exponentially on average whilst
+ * spreading retries of devices that failed at the same time (e.g. after a gateway outage).
+ */
+struct backoff_t {
+	uint32_t base_ms;
+	uint32_t cap_ms;
+	uint32_t delay_ms;
+	/* Uptime (in ms) when the last delay ends */
+	int64_t retry_time;
+};
+
+#define BACKOFF_INIT(_base_ms, _cap_ms)		\
+	{					\
+		.base_ms = (_base_ms),		\
+		.cap_ms = (_cap_ms),		\
+		.delay_ms = (_base_ms),		\
+		.retry_time = 0,		\
+	}
+
+/* Seed the jitter with device specific data (e.g. dev EUI) so devices do not retry in sync */
+void backoff_seed(const uint8_t *data, size_t size);
+
+/* Get the next retry delay (in ms) */
+uint32_t backoff_next(struct backoff_t *backoff);
+
+/* Sleep for the next retry delay */
+void backoff_sleep(struct backoff_t *backoff);
+
+/* Sleep for the next retry delay if it ends before deadline (uptime in ms), returns 0 after
+ * sleeping or -ETIMEDOUT (without sleeping) if the deadline would be passed, in which case the
+ * caller must not retry until backoff_ready() returns true
+ */
+int backoff_sleep_until(struct backoff_t *backoff, int64_t deadline);
+
+/* Check if the last retry delay has ended */
+bool backoff_ready(const struct backoff_t *backoff);
+
+/* Reset the delay to the base value (after a success) */
+void backoff_reset(struct backoff_t *backoff);
+
+#endif /* APP_BACKOFF_H */
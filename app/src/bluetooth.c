@@ -9,12 +9,17 @@
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/bluetooth/conn.h>
 #include <zephyr/bluetooth/gatt.h>
-#include <zephyr/settings/settings.h>
 #include <zephyr/logging/log.h>
 #include "bluetooth.h"
 #include "settings.h"
 #include "leds.h"
 #include "watchdog.h"
+#include "energy.h"
+
+#ifdef CONFIG_APP_LORA_ALLOW_DOWNLINKS
+#include "downlink.h"
+#include "protocol.h"
+#endif
 
 LOG_MODULE_REGISTER(bluetooth, CONFIG_APP_BLUETOOTH_LOG_LEVEL);
 
@@ -37,6 +42,8 @@ K_TIMER_DEFINE(stop_advertising_timer, stop_advertising_function, NULL);
 #endif
 
 static bool in_connection = false;
+static bool advertising = false;
+static bool suspended = false;
 static struct k_work advertise_work;
 
 static const struct bt_data ad[] = {
@@ -78,11 +85,26 @@ static bool connection_security_updated = false;
 #define BT_ADV_INTERVAL_MAX 640
 #endif
 
+/* Track advertising state for energy accounting, connecting stops one time adverts */
+static void advertising_set(bool active)
+{
+	if (active != advertising) {
+		advertising = active;
+
+		if (active) {
+			energy_start(ENERGY_CONSUMER_BLE_ADVERTISING);
+		} else {
+			energy_stop(ENERGY_CONSUMER_BLE_ADVERTISING);
+		}
+	}
+}
+
 #ifdef CONFIG_APP_BT_MODE_ADVERTISE_ON_DEMAND
 static void stop_advertising(struct k_work *work)
 {
 	led_off(LED_BLUE);
 	bt_le_adv_stop();
+	advertising_set(false);
 }
 
 static void stop_advertising_function(struct k_timer *timer_id)
@@ -113,10 +135,14 @@ static void advertise(struct k_work *work)
 	int rc;
 	uint8_t device_name[BLUETOOTH_DEVICE_NAME_SIZE] = { 0 };
 
+	if (suspended == true) {
+		return;
+	}
+
 	/* Get device name to advertise with */
-	rc = settings_runtime_get("app/bluetooth_name", device_name, sizeof(device_name));
+	app_keys_get_bluetooth_name((char *)device_name);
 
-	if (rc <= 0 || device_name[0] == 0x00) {
+	if (device_name[0] == 0x00) {
 		strcpy(device_name, CONFIG_BT_DEVICE_NAME);
 		LOG_INF("Device name not set, using default");
 	} else {
@@ -156,16 +182,23 @@ static void advertise(struct k_work *work)
 
 	if (rc) {
 		LOG_ERR("Advert start failed: %d", rc);
+		advertising_set(false);
 
 #ifdef CONFIG_APP_WATCHDOG
 		watchdog_fatal();
 #endif
+	} else {
+		advertising_set(true);
 	}
 }
 
 #ifdef CONFIG_APP_BT_MODE_ADVERTISE_ON_DEMAND
 static void advertise2(struct k_work *work)
 {
+	if (suspended == true) {
+		return;
+	}
+
 	k_timer_start(&stop_advertising_timer, K_SECONDS(20), K_NO_WAIT);
 
 	if (continue_advert == false) {
@@ -182,6 +215,8 @@ static void advertise2(struct k_work *work)
 
 static void connected(struct bt_conn *conn, uint8_t err)
 {
+	advertising_set(false);
+
 	if (err) {
 		LOG_ERR("Connection failed (err 0x%02x)", err);
 		do_advert();
@@ -316,6 +351,20 @@ int bluetooth_remote(enum bluetooth_remote_op_t op)
 	return 0;
 }
 
+#ifdef CONFIG_APP_LORA_ALLOW_DOWNLINKS
+static int bluetooth_downlink(const uint8_t *data, uint8_t len)
+{
+	if (len < 1) {
+		return -EINVAL;
+	}
+
+	return bluetooth_remote(data[0]);
+}
+
+DOWNLINK_HANDLER_DEFINE(bluetooth_downlink_handler, LORA_DOWNLINK_TYPE_BLUETOOTH,
+			bluetooth_downlink);
+#endif
+
 #if defined(CONFIG_BT_SMP)
 static void auth_passkey_display(struct bt_conn *conn, unsigned int passkey)
 {
@@ -406,7 +455,7 @@ int bluetooth_init(void)
 	}
 
 	if (IS_ENABLED(CONFIG_SETTINGS)) {
-		settings_load();
+		setting_load_all();
 	}
 
 #ifdef CONFIG_APP_BT_MODE_ADVERTISE_ON_DEMAND
@@ -439,14 +488,9 @@ int bluetooth_init(void)
 	bt_conn_auth_cb_register(&auth_cb_display);
 	bt_conn_auth_info_cb_register(&auth_cb_info);
 #if defined(CONFIG_BT_FIXED_PASSKEY)
-
-	rc = settings_runtime_get("app/bluetooth_fixed_passkey", (uint8_t *)&fixed_passkey, sizeof(fixed_passkey));
-	if (rc == sizeof(fixed_passkey)) {
-		bt_passkey_set(fixed_passkey);
-		LOG_DBG("Fixed passkey set to %06u - THIS IS VERY INSECURE", fixed_passkey);
-	}
-
-	rc = 0;
+	fixed_passkey = app_keys_get_bluetooth_fixed_passkey();
+	bt_passkey_set(fixed_passkey);
+	LOG_DBG("Fixed passkey set to %06u - THIS IS VERY INSECURE", fixed_passkey);
 #endif
 #endif
 
@@ -465,6 +509,33 @@ int bluetooth_init(void)
 	return rc;
 }
 
+void bluetooth_suspend(bool suspend)
+{
+	suspended = suspend;
+
+	if (suspend == true) {
+#ifdef CONFIG_APP_BT_MODE_ADVERTISE_ON_DEMAND
+		k_timer_stop(&stop_advertising_timer);
+		continue_advert = false;
+		led_off(LED_BLUE);
+#endif
+
+		if (in_connection) {
+			bt_conn_disconnect(active_conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+		} else {
+			bt_le_adv_stop();
+		}
+
+		advertising_set(false);
+	} else {
+#ifdef CONFIG_APP_BT_MODE_ALWAYS_ADVERTISE
+		if (in_connection == false) {
+			advertise(NULL);
+		}
+#endif
+	}
+}
+
 #if defined(CONFIG_BT_SMP)
 void bluetooth_clear_bonds(void)
 {
@@ -475,6 +546,7 @@ void bluetooth_clear_bonds(void)
 		bt_conn_disconnect(active_conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
 	} else {
 		bt_le_adv_stop();
+		advertising_set(false);
 	}
 
 	rc = bt_unpair(BT_ID_DEFAULT, NULL);
@@ -33,6 +33,9 @@ void bluetooth_garage_characteristic_written(void);
 /* Clears all Bluetooth bonds */
 void bluetooth_clear_bonds(void);
 
+/* Stop (and disconnect) or allow Bluetooth advertising whilst the device is suspended */
+void bluetooth_suspend(bool suspend);
+
 /* Remote LoRa function for bluetooth */
 int bluetooth_remote(enum bluetooth_remote_op_t op);
 
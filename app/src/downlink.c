@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "downlink.h"
+#include "protocol.h"
+#include "lora.h"
+#include "uplink_queue.h"
+
+LOG_MODULE_REGISTER(downlink, CONFIG_APP_DOWNLINK_LOG_LEVEL);
+
+/* Size of each record header in a multiple command downlink: type and length */
+#define RECORD_HEADER_SIZE 2
+
+static void downlink_command(uint8_t type, const uint8_t *data, uint8_t len)
+{
+	int rc;
+	uint8_t response[PAYLOAD_UPLINK_ERROR_NO_HANDLER_SIZE];
+
+	STRUCT_SECTION_FOREACH(downlink_handler_t, entry) {
+		if (entry->type == type) {
+			rc = entry->handler(data, len);
+
+			if (rc != 0) {
+				LOG_ERR("LoRa downlink type %d handler failed: %d", type, rc);
+			}
+
+			return;
+		}
+	}
+
+	LOG_ERR("No handler for LoRa Downlink type %d", type);
+
+	(void)payload_uplink_error_no_handler_encode(response, type);
+
+	(void)uplink_queue_add(LORA_APP_PORT, UPLINK_QUEUE_PRIORITY_NORMAL, 0, response,
+			       sizeof(response));
+}
+
+void lora_message_callback(uint8_t port, const uint8_t *data, uint8_t len)
+{
+	uint8_t pos = 1;
+
+	if (port != LORA_APP_PORT) {
+		return;
+	}
+
+	if (len == 0) {
+		LOG_DBG("Received 0 byte download on port %d", port);
+		return;
+	}
+
+	if (data[0] != LORA_DOWNLINK_TYPE_MULTIPLE) {
+		downlink_command(data[0], &data[1], (len - 1));
+		return;
+	}
+
+	while ((pos + RECORD_HEADER_SIZE) <= len) {
+		uint8_t type = data[pos];
+		uint8_t record_size = data[pos + 1];
+
+		pos += RECORD_HEADER_SIZE;
+
+		if (record_size > (len - pos)) {
+			LOG_ERR("LoRa downlink record type %d truncated: %d/%d", type, (len - pos),
+				record_size);
+			return;
+		}
+
+		downlink_command(type, &data[pos], record_size);
+		pos += record_size;
+	}
+
+	if (pos != len) {
+		LOG_ERR("LoRa downlink has %d trailing bytes", (len - pos));
+	}
+}
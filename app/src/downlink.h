@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_DOWNLINK_H
+#define APP_DOWNLINK_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/iterable_sections.h>
+
+/*
+ * Application downlinks on LORA_APP_PORT are either a single command: type followed by the
+ * command data, or multiple commands: LORA_DOWNLINK_TYPE_MULTIPLE followed by records of type,
+ * length and command data. Each command is passed to the handler registered for its type.
+ */
+struct downlink_handler_t {
+	uint8_t type;
+
+	/* Handle command data (excluding type), returns 0 on success or negative error code */
+	int (*handler)(const uint8_t *data, uint8_t len);
+};
+
+/* Register a handler for a downlink type */
+#define DOWNLINK_HANDLER_DEFINE(_name, _type, _handler)			\
+	const STRUCT_SECTION_ITERABLE(downlink_handler_t, _name) = {	\
+		.type = (_type),					\
+		.handler = (_handler),					\
+	}
+
+#endif /* APP_DOWNLINK_H */
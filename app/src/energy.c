@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "energy.h"
+
+LOG_MODULE_REGISTER(energy, CONFIG_APP_ENERGY_LOG_LEVEL);
+
+#define HOURS_PER_DAY 24
+
+struct energy_counter_t {
+	/* Number of nested starts */
+	uint8_t active;
+	/* Uptime (in ticks) at which the consumer became active */
+	int64_t start;
+	/* Cumulative active time, in ticks */
+	uint64_t total;
+};
+
+/* Current drawn by each consumer whilst active on top of the sleep current, in uA */
+static const uint32_t consumer_current_ua[ENERGY_CONSUMER_COUNT] = {
+	[ENERGY_CONSUMER_HFCLK] = CONFIG_APP_ENERGY_HFCLK_CURRENT,
+	[ENERGY_CONSUMER_RADIO_TX] = CONFIG_APP_ENERGY_RADIO_TX_CURRENT,
+	[ENERGY_CONSUMER_RADIO_RX] = CONFIG_APP_ENERGY_RADIO_RX_CURRENT,
+	[ENERGY_CONSUMER_SENSOR] = CONFIG_APP_ENERGY_SENSOR_CURRENT,
+	[ENERGY_CONSUMER_ADC] = CONFIG_APP_ENERGY_ADC_CURRENT,
+	[ENERGY_CONSUMER_BLE_ADVERTISING] = CONFIG_APP_ENERGY_BLE_ADVERTISING_CURRENT,
+	[ENERGY_CONSUMER_LED] = CONFIG_APP_ENERGY_LED_CURRENT,
+};
+
+static const char *const consumer_names[ENERGY_CONSUMER_COUNT] = {
+	[ENERGY_CONSUMER_HFCLK] = "hfclk",
+	[ENERGY_CONSUMER_RADIO_TX] = "radio tx",
+	[ENERGY_CONSUMER_RADIO_RX] = "radio rx",
+	[ENERGY_CONSUMER_SENSOR] = "sensor",
+	[ENERGY_CONSUMER_ADC] = "adc",
+	[ENERGY_CONSUMER_BLE_ADVERTISING] = "ble advertising",
+	[ENERGY_CONSUMER_LED] = "led",
+};
+
+static struct energy_counter_t counters[ENERGY_CONSUMER_COUNT];
+static struct k_spinlock energy_lock;
+
+void energy_start(enum energy_consumer_t consumer)
+{
+	k_spinlock_key_t key;
+
+	if (consumer >= ENERGY_CONSUMER_COUNT) {
+		return;
+	}
+
+	key = k_spin_lock(&energy_lock);
+
+	if (counters[consumer].active == 0) {
+		counters[consumer].start = k_uptime_ticks();
+	}
+
+	if (counters[consumer].active < UINT8_MAX) {
+		++counters[consumer].active;
+	}
+
+	k_spin_unlock(&energy_lock, key);
+}
+
+void energy_stop(enum energy_consumer_t consumer)
+{
+	k_spinlock_key_t key;
+
+	if (consumer >= ENERGY_CONSUMER_COUNT) {
+		return;
+	}
+
+	key = k_spin_lock(&energy_lock);
+
+	if (counters[consumer].active == 0) {
+		k_spin_unlock(&energy_lock, key);
+		LOG_WRN("Stop without start for %s", consumer_names[consumer]);
+		return;
+	}
+
+	--counters[consumer].active;
+
+	if (counters[consumer].active == 0) {
+		counters[consumer].total += k_uptime_ticks() - counters[consumer].start;
+	}
+
+	k_spin_unlock(&energy_lock, key);
+}
+
+void energy_add(enum energy_consumer_t consumer, uint32_t time_us)
+{
+	k_spinlock_key_t key;
+
+	if (consumer >= ENERGY_CONSUMER_COUNT) {
+		return;
+	}
+
+	key = k_spin_lock(&energy_lock);
+	counters[consumer].total += k_us_to_ticks_ceil64(time_us);
+	k_spin_unlock(&energy_lock, key);
+}
+
+void energy_get_status(struct energy_status_t *status)
+{
+	uint8_t i = 0;
+	int64_t now;
+	uint64_t uptime_ms;
+	/* Charge used by active consumers, in uA ms */
+	uint64_t active_charge = 0;
+	k_spinlock_key_t key = k_spin_lock(&energy_lock);
+
+	now = k_uptime_ticks();
+
+	while (i < ENERGY_CONSUMER_COUNT) {
+		uint64_t total = counters[i].total;
+
+		/* Include the current period of consumers which are still active */
+		if (counters[i].active > 0) {
+			total += now - counters[i].start;
+		}
+
+		status->active_ms[i] = (uint32_t)k_ticks_to_ms_floor64(total);
+		active_charge += k_ticks_to_ms_floor64(total) * consumer_current_ua[i];
+		++i;
+	}
+
+	k_spin_unlock(&energy_lock, key);
+
+	uptime_ms = k_ticks_to_ms_floor64(now);
+
+	if (uptime_ms == 0) {
+		uptime_ms = 1;
+	}
+
+	/* Average current (sleep current plus active charge spread over uptime) for a day */
+	status->uah_per_day = (uint32_t)((((uint64_t)CONFIG_APP_ENERGY_SLEEP_CURRENT * uptime_ms) +
+					  active_charge) * HOURS_PER_DAY / uptime_ms);
+}
+
+const char *energy_consumer_name(enum energy_consumer_t consumer)
+{
+	if (consumer >= ENERGY_CONSUMER_COUNT) {
+		return "unknown";
+	}
+
+	return consumer_names[consumer];
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_ENERGY_H
+#define APP_ENERGY_H
+
+#include <zephyr/kernel.h>
+
+enum energy_consumer_t {
+	ENERGY_CONSUMER_HFCLK,
+	ENERGY_CONSUMER_RADIO_TX,
+	ENERGY_CONSUMER_RADIO_RX,
+	ENERGY_CONSUMER_SENSOR,
+	ENERGY_CONSUMER_ADC,
+	ENERGY_CONSUMER_BLE_ADVERTISING,
+	ENERGY_CONSUMER_LED,
+
+	ENERGY_CONSUMER_COUNT
+};
+
+struct energy_status_t {
+	/* Cumulative active time of each consumer since boot, in ms */
+	uint32_t active_ms[ENERGY_CONSUMER_COUNT];
+	/* Estimated average consumption from the current model, in uAh per day */
+	uint32_t uah_per_day;
+};
+
+#ifdef CONFIG_APP_ENERGY
+/* Mark a consumer as active, calls can be nested (e.g. multiple LEDs) */
+void energy_start(enum energy_consumer_t consumer);
+
+/* Mark a consumer as inactive once all nested starts have been stopped */
+void energy_stop(enum energy_consumer_t consumer);
+
+/* Add active time (in us) to a consumer which cannot be timed directly */
+void energy_add(enum energy_consumer_t consumer, uint32_t time_us);
+
+/* Get active times and estimated consumption */
+void energy_get_status(struct energy_status_t *status);
+
+/* Get name of a consumer */
+const char *energy_consumer_name(enum energy_consumer_t consumer);
+#else
+static inline void energy_start(enum energy_consumer_t consumer)
+{
+}
+
+static inline void energy_stop(enum energy_consumer_t consumer)
+{
+}
+
+static inline void energy_add(enum energy_consumer_t consumer, uint32_t time_us)
+{
+}
+#endif
+
+#endif /* APP_ENERGY_H */
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/fs/nvs.h>
+#include <zephyr/settings/settings.h>
+#include "flash_maintenance.h"
+#include "trace.h"
+
+LOG_MODULE_REGISTER(flash_maintenance, CONFIG_APP_FLASH_MAINTENANCE_LOG_LEVEL);
+
+/* NVS ID used for the persistent erase count, below the backlog and settings IDs */
+#define FLASH_ID_ERASES 0x0f00
+
+static struct nvs_fs *flash_fs = NULL;
+static uint32_t erases = 0;
+static uint32_t saved_erases = 0;
+static uint16_t gc_runs = 0;
+/* Flash used by all writes, by writes between flash_maintenance_write_start() and
+ * flash_maintenance_write_end() (including idle garbage collection) and the application data
+ * those writes stored, since boot
+ */
+static uint32_t bytes_written = 0;
+static uint32_t tracked_bytes = 0;
+static uint32_t data_bytes = 0;
+static ssize_t last_sector_free;
+static K_MUTEX_DEFINE(flash_lock);
+
+/* Account for flash used since the last call, from the free space in the current sector. When
+ * NVS moves to the next sector, it garbage collects (and erases) the sector after it and the
+ * rest of the previous sector can no longer be used, so each sector counts as sector_size bytes
+ * once it has been left. Returns the number of bytes used, must be called with the lock held
+ */
+static uint32_t flash_update(void)
+{
+	ssize_t sector_free = nvs_sector_max_data_size(flash_fs);
+	uint32_t used;
+
+	if (sector_free > last_sector_free) {
+		++erases;
+		used = (uint32_t)(last_sector_free + flash_fs->sector_size - sector_free);
+	} else {
+		used = (uint32_t)(last_sector_free - sector_free);
+	}
+
+	last_sector_free = sector_free;
+	bytes_written += used;
+
+	return used;
+}
+
+int flash_maintenance_init(void)
+{
+	int rc;
+
+	rc = settings_storage_get((void **)&flash_fs);
+
+	if (rc != 0 || flash_fs == NULL) {
+		LOG_ERR("Settings storage get failed: %d", rc);
+		flash_fs = NULL;
+		return (rc != 0 ? rc : -ENOENT);
+	}
+
+	rc = nvs_read(flash_fs, FLASH_ID_ERASES, &erases, sizeof(erases));
+
+	if (rc != sizeof(erases)) {
+		erases = 0;
+	}
+
+	saved_erases = erases;
+	last_sector_free = nvs_sector_max_data_size(flash_fs);
+
+	return 0;
+}
+
+void flash_maintenance_write_start(void)
+{
+	if (flash_fs == NULL) {
+		return;
+	}
+
+	k_mutex_lock(&flash_lock, K_FOREVER);
+
+	/* Flash used by other writes (e.g. the LoRaWAN stack) since the last sample */
+	(void)flash_update();
+}
+
+void flash_maintenance_write_end(size_t size)
+{
+	if (flash_fs == NULL) {
+		return;
+	}
+
+	tracked_bytes += flash_update();
+	data_bytes += size;
+
+	k_mutex_unlock(&flash_lock);
+}
+
+void flash_maintenance_idle(void)
+{
+	ssize_t sector_free;
+	int rc;
+
+	if (flash_fs == NULL) {
+		return;
+	}
+
+	flash_maintenance_write_start();
+	sector_free = last_sector_free;
+
+	if (sector_free >= 0 && sector_free < CONFIG_APP_FLASH_MAINTENANCE_GC_THRESHOLD) {
+		/* Close the current sector, NVS garbage collects the sector after it now instead of
+		 * on a later write
+		 */
+		trace_enter(TRACE_POINT_FLASH_GC);
+		rc = nvs_sector_use_next(flash_fs);
+		trace_exit(TRACE_POINT_FLASH_GC, rc);
+
+		if (rc == 0) {
+			if (gc_runs < UINT16_MAX) {
+				++gc_runs;
+			}
+
+			LOG_DBG("Idle garbage collection complete");
+		} else {
+			LOG_ERR("Idle garbage collection failed: %d", rc);
+		}
+	}
+
+	if (erases != saved_erases) {
+		/* Erase count is written with the lock held, so the sector change it may cause is
+		 * included in the saved value next time
+		 */
+		uint32_t value = erases;
+
+		rc = nvs_write(flash_fs, FLASH_ID_ERASES, &value, sizeof(value));
+
+		if (rc < 0) {
+			LOG_ERR("Erase count save failed: %d", rc);
+		} else {
+			saved_erases = value;
+		}
+	}
+
+	/* Garbage collection copies and the erase count are overhead, not application data */
+	flash_maintenance_write_end(0);
+}
+
+int flash_maintenance_get_stats(struct flash_maintenance_stats_t *stats)
+{
+	ssize_t free_space;
+	ssize_t sector_free;
+
+	if (flash_fs == NULL) {
+		return -ENOENT;
+	}
+
+	k_mutex_lock(&flash_lock, K_FOREVER);
+	(void)flash_update();
+	sector_free = last_sector_free;
+	free_space = nvs_calc_free_space(flash_fs);
+	stats->erases = erases;
+	stats->bytes_written = bytes_written;
+	stats->data_bytes = data_bytes;
+	stats->gc_runs = gc_runs;
+
+	if (data_bytes > 0) {
+		stats->write_amplification = (uint16_t)MIN(((uint64_t)tracked_bytes * 100) /
+							    data_bytes, UINT16_MAX);
+	} else {
+		stats->write_amplification = 100;
+	}
+
+	k_mutex_unlock(&flash_lock);
+
+	stats->free = (uint16_t)CLAMP(free_space, 0, UINT16_MAX);
+	stats->sector_free = (uint16_t)CLAMP(sector_free, 0, UINT16_MAX);
+	stats->sector_size = flash_fs->sector_size;
+	stats->sector_count = flash_fs->sector_count;
+
+	return 0;
+}
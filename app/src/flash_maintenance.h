@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_FLASH_MAINTENANCE_H
+#define APP_FLASH_MAINTENANCE_H
+
+#include <zephyr/kernel.h>
+
+struct flash_maintenance_stats_t {
+	/* Sector erases of the settings partition, persistent */
+	uint32_t erases;
+	/* Flash used by all writes (data, allocation table entries, garbage collection copies and
+	 * unusable space at the end of sectors) and application data written since boot, in bytes
+	 */
+	uint32_t bytes_written;
+	uint32_t data_bytes;
+	/* Idle garbage collections since boot */
+	uint16_t gc_runs;
+	/* Free space in the partition and in the current sector, in bytes */
+	uint16_t free;
+	uint16_t sector_free;
+	uint16_t sector_size;
+	uint16_t sector_count;
+	/* Flash used per byte of application data by the settings and backlog writes and idle
+	 * garbage collection, in hundredths (100 = no amplification)
+	 */
+	uint16_t write_amplification;
+};
+
+#ifdef CONFIG_APP_FLASH_MAINTENANCE
+/* Setup flash maintenance, must be called after settings have been initialised */
+int flash_maintenance_init(void);
+
+/* Garbage collect the next sector if the current sector is nearly full, to be called when the
+ * device is idle (i.e. not in a LoRaWAN receive window or sending IR) so that writes on the
+ * send path do not have to wait for a sector erase
+ */
+void flash_maintenance_idle(void);
+
+/* Get flash statistics */
+int flash_maintenance_get_stats(struct flash_maintenance_stats_t *stats);
+
+/* Mark the start of a write to the settings partition, holds a lock until
+ * flash_maintenance_write_end() so that the flash used can be measured
+ */
+void flash_maintenance_write_start(void);
+
+/* Mark the end of a write to the settings partition which stored size bytes of application data
+ */
+void flash_maintenance_write_end(size_t size);
+#else
+static inline void flash_maintenance_idle(void)
+{
+}
+
+static inline void flash_maintenance_write_start(void)
+{
+}
+
+static inline void flash_maintenance_write_end(size_t size)
+{
+}
+#endif
+
+#endif /* APP_FLASH_MAINTENANCE_H */
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "frame_packer.h"
+#include "protocol.h"
+
+/* Records are stored in the multiple record format and converted if there is only one */
+#define MULTIPLE_HEADER_SIZE 1
+#define RECORD_LENGTH_SIZE 1
+
+void frame_packer_init(struct frame_packer_t *packer, uint8_t *data, uint8_t max_size)
+{
+	packer->data = data;
+	packer->max_size = max_size;
+	packer->size = MULTIPLE_HEADER_SIZE;
+	packer->count = 0;
+
+	data[0] = LORA_UPLINK_TYPE_MULTIPLE;
+}
+
+uint8_t frame_packer_space(const struct frame_packer_t *packer)
+{
+	if (packer->count == 0) {
+		/* A single record is sent without any overhead */
+		return packer->max_size;
+	} else if ((packer->size + RECORD_LENGTH_SIZE) >= packer->max_size) {
+		return 0;
+	}
+
+	return packer->max_size - packer->size - RECORD_LENGTH_SIZE;
+}
+
+int frame_packer_add(struct frame_packer_t *packer, const uint8_t *record, uint8_t record_size)
+{
+	uint8_t *entry = &packer->data[packer->size];
+
+	if (record_size == 0) {
+		return -EINVAL;
+	} else if (record_size > frame_packer_space(packer)) {
+		return -ENOSPC;
+	}
+
+	entry[0] = record[0];
+	entry[1] = record_size - 1;
+	memcpy(&entry[2], &record[1], (record_size - 1));
+
+	packer->size += record_size + RECORD_LENGTH_SIZE;
+	++packer->count;
+
+	return 0;
+}
+
+uint8_t frame_packer_finish(struct frame_packer_t *packer)
+{
+	uint8_t *data = packer->data;
+	uint8_t length;
+
+	if (packer->count == 0) {
+		return 0;
+	} else if (packer->count > 1) {
+		return packer->size;
+	}
+
+	/* Single record, remove multiple record header and length */
+	length = data[2];
+	data[0] = data[1];
+	memmove(&data[1], &data[3], length);
+
+	return length + 1;
+}
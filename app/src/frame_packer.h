@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_FRAME_PACKER_H
+#define APP_FRAME_PACKER_H
+
+#include <stdint.h>
+
+/* Additional buffer space needed by the packer on top of the maximum frame size */
+#define FRAME_PACKER_OVERHEAD 2
+
+/*
+ * Packs records (type followed by data) into a single uplink frame. A frame with one record is
+ * sent as the record itself, a frame with multiple records starts with LORA_UPLINK_TYPE_MULTIPLE
+ * followed by each record encoded as type, length of data and data.
+ */
+struct frame_packer_t {
+	uint8_t *data;
+	uint8_t max_size;
+	uint8_t size;
+	uint8_t count;
+};
+
+/* Setup packer, data must have space for max_size + FRAME_PACKER_OVERHEAD bytes */
+void frame_packer_init(struct frame_packer_t *packer, uint8_t *data, uint8_t max_size);
+
+/* Get the largest record (type and data) that can still be added */
+uint8_t frame_packer_space(const struct frame_packer_t *packer);
+
+/* Add a record (type and data), returns -ENOSPC if it does not fit */
+int frame_packer_add(struct frame_packer_t *packer, const uint8_t *record, uint8_t record_size);
+
+/* Finalise the frame, returns the size of the frame (0 if no records were added) */
+uint8_t frame_packer_finish(struct frame_packer_t *packer);
+
+#endif /* APP_FRAME_PACKER_H */
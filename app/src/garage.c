@@ -12,6 +12,13 @@
 #include "bluetooth.h"
 #include "watchdog.h"
 
+#ifdef CONFIG_APP_LORA_ALLOW_DOWNLINKS
+#include "downlink.h"
+#include "protocol.h"
+#include "lora.h"
+#include "uplink_queue.h"
+#endif
+
 LOG_MODULE_REGISTER(garage, CONFIG_APP_GARAGE_LOG_LEVEL);
 
 #define BUTTON_ALIAS DT_ALIAS(sw0)
@@ -157,3 +164,18 @@ void garage_door_open_close(void)
 {
 	k_sem_give(&door_sem);
 }
+
+#ifdef CONFIG_APP_LORA_ALLOW_DOWNLINKS
+static int garage_downlink(const uint8_t *data, uint8_t len)
+{
+	uint8_t response = LORA_UPLINK_TYPE_GARAGE_COMPLETE;
+
+	garage_door_open_close();
+
+	/* Send response indicating request has been actioned */
+	return uplink_queue_add(LORA_APP_PORT, UPLINK_QUEUE_PRIORITY_HIGH, 0, &response,
+				sizeof(response));
+}
+
+DOWNLINK_HANDLER_DEFINE(garage_downlink_handler, LORA_DOWNLINK_TYPE_GARAGE, garage_downlink);
+#endif
@@ -9,6 +9,8 @@
 #include <zephyr/drivers/clock_control/nrf_clock_control.h>
 #include <zephyr/logging/log.h>
 #include "hfclk.h"
+#include "energy.h"
+#include "trace.h"
 
 LOG_MODULE_REGISTER(hfclk, CONFIG_APP_HFCLK_LOG_LEVEL);
 
@@ -22,6 +24,7 @@ int hfclk_enable()
 {
 	int rc = 0;
 
+	trace_enter(TRACE_POINT_HFCLK_ENABLE);
 	k_sem_take(&hfclk_usage_sem, K_FOREVER);
 
 	if (hfclk_count == 0) {
@@ -31,12 +34,15 @@ int hfclk_enable()
 			LOG_ERR("HFCLK enable failed: %d", rc);
 			goto finish;
 		}
+
+		energy_start(ENERGY_CONSUMER_HFCLK);
 	}
 
 	++hfclk_count;
 
 finish:
 	k_sem_give(&hfclk_usage_sem);
+	trace_exit(TRACE_POINT_HFCLK_ENABLE, rc);
 
 	return rc;
 }
@@ -62,6 +68,7 @@ int hfclk_disable()
 		LOG_ERR("HFCLK disable failed: %d", rc);
 	} else {
 		hfclk_count = 0;
+		energy_stop(ENERGY_CONSUMER_HFCLK);
 	}
 
 finish:
@@ -69,3 +76,10 @@ finish:
 
 	return rc;
 }
+
+void hfclk_get_status(struct hfclk_status_t *status)
+{
+	k_sem_take(&hfclk_usage_sem, K_FOREVER);
+	status->count = hfclk_count;
+	k_sem_give(&hfclk_usage_sem);
+}
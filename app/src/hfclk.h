@@ -7,10 +7,38 @@
 #ifndef APP_HFCLK_H
 #define APP_HFCLK_H
 
+#include <zephyr/kernel.h>
+
+struct hfclk_status_t {
+	/* Number of users which currently have HFCLK enabled */
+	uint8_t count;
+};
+
+#ifdef CONFIG_SOC_SERIES_NRF51X
 /* Enable HFCLK and wait for it to be ready */
 int hfclk_enable();
 
 /* Disable HFCLK without waiting for it to stop */
 int hfclk_disable();
 
+/* Get HFCLK usage */
+void hfclk_get_status(struct hfclk_status_t *status);
+#else
+/* No HFCLK to control on other SoCs (e.g. native_sim) */
+static inline int hfclk_enable(void)
+{
+	return 0;
+}
+
+static inline int hfclk_disable(void)
+{
+	return 0;
+}
+
+static inline void hfclk_get_status(struct hfclk_status_t *status)
+{
+	status->count = 0;
+}
+#endif
+
 #endif /* APP_HFCLK_H */
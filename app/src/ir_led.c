@@ -10,6 +10,14 @@
 #include <zephyr/drivers/counter.h>
 #include "ir_led.h"
 #include "hfclk.h"
+#include "trace.h"
+
+#ifdef CONFIG_APP_LORA_ALLOW_DOWNLINKS
+#include "downlink.h"
+#include "protocol.h"
+#include "lora.h"
+#include "uplink_queue.h"
+#endif
 
 LOG_MODULE_REGISTER(ir_led, CONFIG_APP_IR_LED_LOG_LEVEL);
 
@@ -278,3 +286,25 @@ int ir_led_setup()
 
 	return gpio_pin_configure_dt(&led, GPIO_OUTPUT_INACTIVE);
 }
+
+#ifdef CONFIG_APP_LORA_ALLOW_DOWNLINKS
+static int ir_led_downlink(const uint8_t *data, uint8_t len)
+{
+	int rc;
+	uint8_t response = LORA_UPLINK_TYPE_IR_COMPLETE;
+
+	if (len < 1) {
+		return -EINVAL;
+	}
+
+	trace_enter(TRACE_POINT_IR_LED_SEND);
+	rc = ir_led_send(data[0]);
+	trace_exit(TRACE_POINT_IR_LED_SEND, rc);
+
+	/* Send response indicating request has been actioned */
+	return uplink_queue_add(LORA_APP_PORT, UPLINK_QUEUE_PRIORITY_HIGH, 0, &response,
+				sizeof(response));
+}
+
+DOWNLINK_HANDLER_DEFINE(ir_led_downlink_handler, LORA_DOWNLINK_TYPE_IR, ir_led_downlink);
+#endif
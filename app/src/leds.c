@@ -5,6 +5,7 @@
  */
 
 #include "leds.h"
+#include "energy.h"
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/logging/log.h>
 
@@ -20,6 +21,20 @@
 static const struct gpio_dt_spec led_red = LED_RED_DEVICE;
 static const struct gpio_dt_spec led_green = LED_GREEN_DEVICE;
 static const struct gpio_dt_spec led_blue = LED_BLUE_DEVICE;
+
+/* LEDs which are lit, each counts once towards LED energy usage */
+static atomic_t leds_lit;
+
+static void led_energy(enum led_t led, bool lit)
+{
+	if (lit) {
+		if (!atomic_test_and_set_bit(&leds_lit, led)) {
+			energy_start(ENERGY_CONSUMER_LED);
+		}
+	} else if (atomic_test_and_clear_bit(&leds_lit, led)) {
+		energy_stop(ENERGY_CONSUMER_LED);
+	}
+}
 #endif
 
 LOG_MODULE_REGISTER(leds, CONFIG_APP_LEDS_LOG_LEVEL);
@@ -99,6 +114,8 @@ void led_on(enum led_t led)
 
 	if (rc < 0) {
 		LOG_ERR("LED on failed: %d", rc);
+	} else {
+		led_energy(led, true);
 	}
 #endif
 }
@@ -118,6 +135,8 @@ void led_off(enum led_t led)
 
 	if (rc < 0) {
 		LOG_ERR("LED off failed: %d", rc);
+	} else {
+		led_energy(led, false);
 	}
 #endif
 }
@@ -140,12 +159,15 @@ void led_blink(enum led_t led, k_timeout_t delay)
 		return;
 	}
 
+	led_energy(led, true);
 	k_sleep(delay);
 
 	rc = gpio_pin_set_dt(led_device, 0);
 
 	if (rc < 0) {
 		LOG_ERR("LED off failed: %d", rc);
+	} else {
+		led_energy(led, false);
 	}
 
 	k_sleep(delay);
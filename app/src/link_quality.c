@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/lorawan/lorawan.h>
+#include "link_quality.h"
+#include "lora.h"
+
+LOG_MODULE_REGISTER(link_quality, CONFIG_APP_LORA_CONFIRMED_PACKET_ADAPTIVE_LOG_LEVEL);
+
+/* Averages are stored multiplied by 4 and each new sample has a weight of 1/4 */
+#define AVERAGE_SCALE 4
+
+/* EU868 datarates 0-5 are SF12-SF7, datarate 6 is SF7 at 250KHz */
+#define SPREADING_FACTOR_MIN 7
+#define SPREADING_FACTOR_MAX 12
+
+/* SNR (in 0.1dB) required to demodulate SF7, each spreading factor increase lowers it by 2.5dB */
+#define SNR_FLOOR_SF7 -75
+#define SNR_FLOOR_STEP 25
+
+#define INTERVAL_MIN CONFIG_APP_LORA_CONFIRMED_PACKET_AFTER
+#define INTERVAL_MAX CONFIG_APP_LORA_CONFIRMED_PACKET_ADAPTIVE_MAX
+
+static void link_quality_downlink(uint8_t port, bool data_pending, int16_t rssi, int8_t snr,
+				  uint8_t len, const uint8_t *hex_data);
+
+static struct lorawan_downlink_cb link_quality_downlink_cb = {
+	.port = LW_RECV_PORT_ANY,
+	.cb = link_quality_downlink
+};
+
+static int32_t rssi_average = 0;
+static int32_t snr_average = 0;
+static uint16_t downlinks = 0;
+static bool downlink_since_confirmed = false;
+static uint8_t interval = INTERVAL_MIN;
+static uint8_t unconfirmed = INTERVAL_MIN;
+static uint16_t acks_missed = 0;
+static struct k_spinlock link_quality_lock;
+
+static void link_quality_downlink(uint8_t port, bool data_pending, int16_t rssi, int8_t snr,
+				  uint8_t len, const uint8_t *hex_data)
+{
+	k_spinlock_key_t key = k_spin_lock(&link_quality_lock);
+
+	if (downlinks == 0) {
+		rssi_average = (int32_t)rssi * AVERAGE_SCALE;
+		snr_average = (int32_t)snr * AVERAGE_SCALE;
+	} else {
+		rssi_average += rssi - (rssi_average / AVERAGE_SCALE);
+		snr_average += snr - (snr_average / AVERAGE_SCALE);
+	}
+
+	if (downlinks < UINT16_MAX) {
+		++downlinks;
+	}
+
+	downlink_since_confirmed = true;
+	k_spin_unlock(&link_quality_lock, key);
+}
+
+/* Must be called with the lock held */
+static bool link_quality_healthy(void)
+{
+	uint8_t datarate = lora_get_datarate();
+	uint8_t spreading_factor = SPREADING_FACTOR_MIN;
+	int32_t snr_floor;
+
+	if (downlink_since_confirmed == false) {
+		/* No recent signal information, do not assume the link is good */
+		return false;
+	}
+
+	if (datarate <= (SPREADING_FACTOR_MAX - SPREADING_FACTOR_MIN)) {
+		spreading_factor = SPREADING_FACTOR_MAX - datarate;
+	}
+
+	snr_floor = SNR_FLOOR_SF7 - (spreading_factor - SPREADING_FACTOR_MIN) * SNR_FLOOR_STEP;
+
+	return ((snr_average * 10 / AVERAGE_SCALE) - snr_floor) >=
+	       (CONFIG_APP_LORA_CONFIRMED_PACKET_ADAPTIVE_SNR_MARGIN * 10);
+}
+
+void link_quality_init(void)
+{
+	lorawan_register_downlink_callback(&link_quality_downlink_cb);
+}
+
+bool link_quality_confirmed_required(void)
+{
+	return unconfirmed >= interval;
+}
+
+void link_quality_sent(bool confirmed, int rc)
+{
+	k_spinlock_key_t key = k_spin_lock(&link_quality_lock);
+
+	if (confirmed == false) {
+		if (rc == 0 && unconfirmed < interval) {
+			++unconfirmed;
+		}
+	} else if (rc == 0) {
+		/* Acknowledged, stretch the interval only if the link has margin to spare */
+		if (link_quality_healthy() == true) {
+			interval = MIN(((uint16_t)interval * 2), INTERVAL_MAX);
+		}
+
+		unconfirmed = 0;
+		downlink_since_confirmed = false;
+		LOG_DBG("Confirmed uplink acknowledged, interval %d", interval);
+	} else {
+		/* Not acknowledged, tighten the interval and confirm the next uplink too */
+		interval = MAX((interval / 4), INTERVAL_MIN);
+		unconfirmed = interval;
+		downlink_since_confirmed = false;
+
+		if (acks_missed < UINT16_MAX) {
+			++acks_missed;
+		}
+
+		LOG_DBG("Confirmed uplink not acknowledged, interval %d", interval);
+	}
+
+	k_spin_unlock(&link_quality_lock, key);
+}
+
+void link_quality_get_status(struct link_quality_status_t *status)
+{
+	k_spinlock_key_t key = k_spin_lock(&link_quality_lock);
+
+	status->rssi = rssi_average / AVERAGE_SCALE;
+	status->snr = snr_average / AVERAGE_SCALE;
+	status->downlinks = downlinks;
+	status->interval = interval;
+	status->unconfirmed = unconfirmed;
+	status->acks_missed = acks_missed;
+	k_spin_unlock(&link_quality_lock, key);
+}
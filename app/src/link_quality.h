@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_LINK_QUALITY_H
+#define APP_LINK_QUALITY_H
+
+#include <zephyr/kernel.h>
+
+struct link_quality_status_t {
+	/* Averaged downlink RSSI (dBm) and SNR (dB), only valid if downlinks is not 0 */
+	int16_t rssi;
+	int8_t snr;
+	uint16_t downlinks;
+	/* Current number of unconfirmed uplinks sent between confirmed uplinks */
+	uint8_t interval;
+	/* Unconfirmed uplinks sent since the last confirmed uplink */
+	uint8_t unconfirmed;
+	uint16_t acks_missed;
+};
+
+/* Setup link quality tracking, registers for downlinks on all ports */
+void link_quality_init(void);
+
+/* Check if the next uplink should be confirmed */
+bool link_quality_confirmed_required(void);
+
+/* Update link quality with the outcome of an uplink */
+void link_quality_sent(bool confirmed, int rc);
+
+/* Get current link quality */
+void link_quality_get_status(struct link_quality_status_t *status);
+
+#endif /* APP_LINK_QUALITY_H */
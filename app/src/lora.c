@@ -12,11 +12,25 @@
 #include "settings.h"
 #include "leds.h"
 #include "watchdog.h"
+#include "backoff.h"
+#include "trace.h"
+#include "telemetry.h"
+
+#ifdef CONFIG_LORAWAN_NVM_SETTINGS
+/* Activation state is not available from the Zephyr LoRaWAN API */
+#include <LoRaMac.h>
+#endif
+
+#if defined(CONFIG_APP_LORA_AIRTIME) || defined(CONFIG_APP_ENERGY)
+#include "airtime.h"
+#endif
+
+#ifdef CONFIG_APP_LORA_CONFIRMED_PACKET_ADAPTIVE
+#include "link_quality.h"
+#endif
 
 #define LORA_JOIN_SUCCESS_LED_BLINK_TIME K_MSEC(750)
 #define LORA_JOIN_FAIL_LED_BLINK_TIME K_MSEC(750)
-#define LORA_JOIN_FAIL_DELAY K_SECONDS(30)
-#define LORA_SEND_FAIL_DELAY K_SECONDS(5)
 
 #define LORA_JOIN_ATTEMPTS 24
 
@@ -26,30 +40,114 @@ LOG_MODULE_REGISTER(lora, CONFIG_APP_LORA_LOG_LEVEL);
 
 static bool lora_setup_complete = false;
 
-#if CONFIG_APP_LORA_CONFIRMED_PACKET_AFTER > 0
+/* Set if the stack restored a joined session from NVM settings at startup (e.g. after waking
+ * from System OFF), cleared once it has been used so that rejoins always join
+ */
+static bool session_restored = false;
+
+/* Retry delays persist between calls so that retries keep backing off until a success */
+static struct backoff_t join_backoff = BACKOFF_INIT(
+	(CONFIG_APP_LORA_JOIN_BACKOFF_BASE * MSEC_PER_SEC),
+	(CONFIG_APP_LORA_JOIN_BACKOFF_CAP * MSEC_PER_SEC));
+static struct backoff_t send_backoff = BACKOFF_INIT(CONFIG_APP_LORA_SEND_BACKOFF_BASE,
+						    CONFIG_APP_LORA_SEND_BACKOFF_CAP);
+
+/* Rejoins since the last successful uplink */
+static uint8_t rejoin_attempts = 0;
+
+#ifdef CONFIG_LORAWAN_NVM_SETTINGS
+/* Check if the stack has an activated session, must be called after lorawan_start() */
+static bool lora_session_active(void)
+{
+	MibRequestConfirm_t mib_req = {
+		.Type = MIB_NETWORK_ACTIVATION,
+	};
+
+	return (LoRaMacMibGetRequestConfirm(&mib_req) == LORAMAC_STATUS_OK &&
+		mib_req.Param.NetworkActivation != ACTIVATION_TYPE_NONE);
+}
+#endif
+
+/* Slowest datarate until told otherwise */
+static uint8_t lora_datarate = LORAWAN_DR_0;
+
+#if CONFIG_APP_LORA_CONFIRMED_PACKET_AFTER > 0 && !defined(CONFIG_APP_LORA_CONFIRMED_PACKET_ADAPTIVE)
 static uint8_t unconfirmed_packets = CONFIG_APP_LORA_CONFIRMED_PACKET_AFTER;
 #endif
 
+/* Status for the shell and telemetry, datarate is kept separately */
+static struct lora_status_t lora_status = { 0 };
+static struct k_spinlock lora_status_lock;
+
+static void lora_status_downlink(uint8_t port, bool data_pending, int16_t rssi, int8_t snr,
+				 uint8_t len, const uint8_t *hex_data);
+
+static struct lorawan_downlink_cb status_downlink_cb = {
+	.port = LW_RECV_PORT_ANY,
+	.cb = lora_status_downlink
+};
+
+static void lora_status_downlink(uint8_t port, bool data_pending, int16_t rssi, int8_t snr,
+				 uint8_t len, const uint8_t *hex_data)
+{
+	k_spinlock_key_t key = k_spin_lock(&lora_status_lock);
+
+	++lora_status.downlinks;
+	lora_status.rssi = rssi;
+	lora_status.snr = snr;
+	k_spin_unlock(&lora_status_lock, key);
+}
+
+static void lora_status_joined(bool joined)
+{
+	k_spinlock_key_t key = k_spin_lock(&lora_status_lock);
+
+	lora_status.joined = joined;
+	k_spin_unlock(&lora_status_lock, key);
+}
+
+static void lora_status_sent(int rc)
+{
+	k_spinlock_key_t key = k_spin_lock(&lora_status_lock);
+
+	if (rc < 0) {
+		++lora_status.uplink_failures;
+	} else {
+		++lora_status.uplinks;
+	}
+
+	k_spin_unlock(&lora_status_lock, key);
+}
+
 #ifdef CONFIG_APP_LORA_ALLOW_DOWNLINKS
 static void lora_downlink(uint8_t port, bool data_pending, int16_t rssi, int8_t snr, uint8_t len,
 			  const uint8_t *hex_data);
 
 static struct lorawan_downlink_cb downlink_cb = {
-	.port = 1,
+	.port = LORA_APP_PORT,
 	.cb = lora_downlink
 };
 
 static void lora_downlink(uint8_t port, bool data_pending, int16_t rssi, int8_t snr, uint8_t len,
 			  const uint8_t *hex_data)
 {
+	trace_enter(TRACE_POINT_DOWNLINK);
 	lora_message_callback(port, hex_data, len);
+	trace_exit(TRACE_POINT_DOWNLINK, 0);
 }
 #endif
 
+static void lora_datarate_changed(enum lorawan_datarate datarate)
+{
+	lora_datarate = datarate;
+	LOG_DBG("Datarate changed to %d", datarate);
+}
+
 int lora_setup(void)
 {
 	int rc;
 	uint16_t join_attempts = 0;
+	int64_t join_deadline;
 	const struct device *lora_dev = LORA_DEVICE;
 	uint8_t dev_eui[LORA_DEV_EUI_SIZE] = { 0 };
 	uint8_t join_eui[LORA_JOIN_EUI_SIZE] = { 0 };
@@ -71,37 +169,24 @@ int lora_setup(void)
 	}
 
 	/* Fetch keys */
-	rc = settings_runtime_get("lora_keys/dev_eui", dev_eui, sizeof(dev_eui));
+	lora_keys_get_dev_eui(dev_eui);
+	lora_keys_get_join_eui(join_eui);
+	lora_keys_get_app_key(app_key);
 
-	if (rc != sizeof(dev_eui)) {
-		LOG_ERR("Invalid setting get dev eui response: %d", rc);
-		return (rc < 0 ? rc : -EINVAL);
-	} else if (memcmp(dev_eui, empty_check, sizeof(dev_eui)) == 0) {
+	if (memcmp(dev_eui, empty_check, sizeof(dev_eui)) == 0) {
 		LOG_ERR("Key not set: dev eui, cannot start LoRa");
 		return -ENOENT;
-	}
-
-	rc = settings_runtime_get("lora_keys/join_eui", join_eui, sizeof(join_eui));
-
-	if (rc != sizeof(join_eui)) {
-		LOG_ERR("Invalid setting get dev eui response: %d", rc);
-		return (rc < 0 ? rc : -EINVAL);
 	} else if (memcmp(join_eui, empty_check, sizeof(join_eui)) == 0) {
 		LOG_ERR("Key not set: join eui, cannot start LoRa");
 		return -ENOENT;
-	}
-
-	rc = settings_runtime_get("lora_keys/app_key", app_key, sizeof(app_key));
-
-	if (rc != sizeof(app_key)) {
-		LOG_ERR("Invalid setting get dev eui response: %d", rc);
-		return (rc < 0 ? rc : -EINVAL);
 	} else if (memcmp(app_key, empty_check, sizeof(app_key)) == 0) {
 		LOG_ERR("Key not set: app key, cannot start LoRa");
 		return -ENOENT;
 	}
 
 	if (!lora_setup_complete) {
+		backoff_seed(dev_eui, sizeof(dev_eui));
+
 		rc = lorawan_start();
 
 		if (rc < 0) {
@@ -109,22 +194,61 @@ int lora_setup(void)
 			return rc;
 		}
 
+#ifdef CONFIG_LORAWAN_NVM_SETTINGS
+		session_restored = lora_session_active();
+#endif
+
 #ifdef CONFIG_APP_LORA_ALLOW_DOWNLINKS
 		lorawan_register_downlink_callback(&downlink_cb);
 #endif
+
+		lorawan_register_downlink_callback(&status_downlink_cb);
+		lorawan_register_dr_changed_callback(lora_datarate_changed);
+
+#ifdef CONFIG_APP_LORA_CONFIRMED_PACKET_ADAPTIVE
+		link_quality_init();
+#endif
+
 		lora_setup_complete = true;
 	}
 
+	lora_status_joined(false);
+
+	if (session_restored == true) {
+		/* If the network no longer has this session, sends fail and the device rejoins */
+		LOG_INF("LoRa session restored, not joining");
+		session_restored = false;
+		rc = 0;
+		lora_status_joined(true);
+		goto joined;
+	}
+
+	if (backoff_ready(&join_backoff) == false) {
+		/* Join retry delay from a previous wake has not ended yet */
+		return -EAGAIN;
+	}
+
+	join_deadline = k_uptime_get() + (CONFIG_APP_LORA_JOIN_MAX_TIME * MSEC_PER_SEC);
+
 	while (join_attempts < LORA_JOIN_ATTEMPTS) {
+		telemetry_count(TELEMETRY_COUNTER_JOIN_ATTEMPTS);
 		rc = lorawan_join(&join_cfg);
 
 		if (rc < 0) {
 			++join_attempts;
 			LOG_ERR("LoRa join failed: %d", rc);
 			led_blink(LED_RED, LORA_JOIN_FAIL_LED_BLINK_TIME);
-			k_sleep(LORA_JOIN_FAIL_DELAY);
+
+			if (backoff_sleep_until(&join_backoff, join_deadline) != 0) {
+				/* Retry on a later wake once the delay has ended, so the main loop
+				 * is not blocked
+				 */
+				return -ETIMEDOUT;
+			}
 		} else if (rc == 0) {
 			led_blink(LED_GREEN, LORA_JOIN_SUCCESS_LED_BLINK_TIME);
+			backoff_reset(&join_backoff);
+			lora_status_joined(true);
 			break;
 		}
 	}
@@ -133,22 +257,24 @@ int lora_setup(void)
 		return -ETIMEDOUT;
 	}
 
+joined:
 #if CONFIG_APP_LORA_USE_SPECIFIC_DATARATE
 	/* Change to desired datarate */
 #if CONFIG_APP_LORA_DATARATE_0
-	(void)lorawan_set_datarate(LORAWAN_DR_0);
+	lora_datarate = LORAWAN_DR_0;
 #elif CONFIG_APP_LORA_DATARATE_1
-	(void)lorawan_set_datarate(LORAWAN_DR_1);
+	lora_datarate = LORAWAN_DR_1;
 #elif CONFIG_APP_LORA_DATARATE_2
-	(void)lorawan_set_datarate(LORAWAN_DR_2);
+	lora_datarate = LORAWAN_DR_2;
 #elif CONFIG_APP_LORA_DATARATE_3
-	(void)lorawan_set_datarate(LORAWAN_DR_3);
+	lora_datarate = LORAWAN_DR_3;
 #elif CONFIG_APP_LORA_DATARATE_4
-	(void)lorawan_set_datarate(LORAWAN_DR_4);
+	lora_datarate = LORAWAN_DR_4;
 #elif CONFIG_APP_LORA_DATARATE_5
-	(void)lorawan_set_datarate(LORAWAN_DR_5);
+	lora_datarate = LORAWAN_DR_5;
 #endif
 
+	(void)lorawan_set_datarate(lora_datarate);
 #endif
 
 #ifdef CONFIG_APP_LORA_USE_ADR
@@ -158,14 +284,26 @@ int lora_setup(void)
 	return (rc >= 0 ? 0 : rc);
 }
 
-int lora_send_message(const uint8_t *data, uint16_t length, bool force_confirmed, uint8_t attempts)
+int lora_send_message(uint8_t port, enum lora_traffic_class_t traffic_class, const uint8_t *data,
+		      uint16_t length, bool force_confirmed, uint8_t attempts)
 {
 	int rc = 0;
 	bool confirmed = false;
 
+#ifdef CONFIG_APP_LORA_AIRTIME
+	if (airtime_allowed(traffic_class, length) == false) {
+		/* Defer message until there is enough airtime available */
+		return -EAGAIN;
+	}
+#endif
+
+	trace_enter(TRACE_POINT_LORA_SEND);
+
 	while (attempts > 0) {
 #if CONFIG_APP_LORA_CONFIRMED_PACKET_ALWAYS
 		confirmed = true;
+#elif defined(CONFIG_APP_LORA_CONFIRMED_PACKET_ADAPTIVE)
+		confirmed = link_quality_confirmed_required();
 #elif CONFIG_APP_LORA_CONFIRMED_PACKET_AFTER > 0
 		confirmed = unconfirmed_packets == CONFIG_APP_LORA_CONFIRMED_PACKET_AFTER ? true : false;
 #endif
@@ -174,17 +312,36 @@ int lora_send_message(const uint8_t *data, uint16_t length, bool force_confirmed
 			confirmed = true;
 		}
 
-		rc = lorawan_send(1, (uint8_t *)data, length, (confirmed == true ? LORAWAN_MSG_CONFIRMED : LORAWAN_MSG_UNCONFIRMED));
+#ifdef CONFIG_APP_LORA_AIRTIME
+		/* Failed attempts may still have been transmitted, so always count them */
+		airtime_record(traffic_class, length);
+#endif
+
+		rc = lorawan_send(port, (uint8_t *)data, length, (confirmed == true ? LORAWAN_MSG_CONFIRMED : LORAWAN_MSG_UNCONFIRMED));
+
+#ifdef CONFIG_APP_ENERGY
+		airtime_energy_record(length);
+#endif
+
+#ifdef CONFIG_APP_LORA_CONFIRMED_PACKET_ADAPTIVE
+		link_quality_sent(confirmed, rc);
+#endif
 
 		if (rc < 0) {
 			--attempts;
 			LOG_ERR("LoRa send failed: %d", rc);
 
 			if (attempts > 0) {
-				k_sleep(LORA_SEND_FAIL_DELAY);
+				telemetry_count(TELEMETRY_COUNTER_SEND_RETRIES);
+				backoff_sleep(&send_backoff);
+			} else {
+				telemetry_count(TELEMETRY_COUNTER_SEND_FAILURES);
 			}
 		} else {
-#if CONFIG_APP_LORA_CONFIRMED_PACKET_AFTER > 0
+			backoff_reset(&send_backoff);
+			rejoin_attempts = 0;
+
+#if CONFIG_APP_LORA_CONFIRMED_PACKET_AFTER > 0 && !defined(CONFIG_APP_LORA_CONFIRMED_PACKET_ADAPTIVE)
 			if (unconfirmed_packets == CONFIG_APP_LORA_CONFIRMED_PACKET_AFTER) {
 				unconfirmed_packets = 0;
 			} else {
@@ -196,6 +353,8 @@ int lora_send_message(const uint8_t *data, uint16_t length, bool force_confirmed
 		}
 	}
 
+	lora_status_sent(rc);
+
 #ifdef CONFIG_APP_WATCHDOG
 	if (attempts == 0 && rc < 0) {
 		LOG_ERR("LoRa send failed too much, triggering watchdog");
@@ -203,5 +362,49 @@ int lora_send_message(const uint8_t *data, uint16_t length, bool force_confirmed
 	}
 #endif
 
+	trace_exit(TRACE_POINT_LORA_SEND, rc);
+
 	return rc;
 }
+
+int lora_rejoin(void)
+{
+	if (rejoin_attempts >= CONFIG_APP_LORA_REJOIN_ATTEMPTS) {
+		LOG_ERR("LoRa rejoin attempts exhausted");
+		return -ECONNABORTED;
+	} else if (backoff_ready(&join_backoff) == false) {
+		/* Waiting for the join retry delay, this is not a rejoin attempt */
+		return -EAGAIN;
+	}
+
+	++rejoin_attempts;
+	LOG_WRN("LoRa rejoining, attempt %d", rejoin_attempts);
+
+	/* The stack is already running, joining again starts a new session */
+	return lora_setup();
+}
+
+uint8_t lora_get_datarate(void)
+{
+	return lora_datarate;
+}
+
+void lora_get_status(struct lora_status_t *status)
+{
+	k_spinlock_key_t key = k_spin_lock(&lora_status_lock);
+
+	*status = lora_status;
+	k_spin_unlock(&lora_status_lock, key);
+
+	status->datarate = lora_datarate;
+}
+
+uint8_t lora_get_max_payload_size(void)
+{
+	uint8_t max_next_payload_size;
+	uint8_t max_payload_size;
+
+	lorawan_get_payload_sizes(&max_next_payload_size, &max_payload_size);
+
+	return max_next_payload_size;
+}
@@ -9,11 +9,54 @@
 
 #include <zephyr/kernel.h>
 
+/* Largest application payload of any datarate */
+#define LORA_MAX_PAYLOAD_SIZE 222
+
+/* Port used for application uplinks and downlinks */
+#define LORA_APP_PORT 1
+
+enum lora_traffic_class_t {
+	LORA_TRAFFIC_CLASS_READINGS,
+	LORA_TRAFFIC_CLASS_ACK,
+	LORA_TRAFFIC_CLASS_SMP,
+
+	LORA_TRAFFIC_CLASS_COUNT,
+};
+
+struct lora_status_t {
+	bool joined;
+	uint8_t datarate;
+	/* Uplinks sent, uplinks which failed after all attempts and downlinks received since
+	 * boot
+	 */
+	uint32_t uplinks;
+	uint32_t uplink_failures;
+	uint32_t downlinks;
+	/* RSSI and SNR of the last downlink (any port), 0 if none have been received */
+	int16_t rssi;
+	int8_t snr;
+};
+
 /* Setup LoRa */
 int lora_setup(void);
 
-/* Send LoRa message */
-int lora_send_message(const uint8_t *data, uint16_t length, bool force_confirmed, uint8_t attempts);
+/* Rejoin the network without restarting the device, returns -ECONNABORTED if there have been
+ * too many rejoins without a successful uplink (in which case the device should be rebooted)
+ */
+int lora_rejoin(void);
+
+/* Send LoRa message, returns -EAGAIN if the airtime budget of the traffic class has been used */
+int lora_send_message(uint8_t port, enum lora_traffic_class_t traffic_class, const uint8_t *data,
+		      uint16_t length, bool force_confirmed, uint8_t attempts);
+
+/* Get maximum application payload size that can be sent in the next uplink */
+uint8_t lora_get_max_payload_size(void);
+
+/* Get current datarate */
+uint8_t lora_get_datarate(void);
+
+/* Get join state, send and receive counts and last downlink signal quality */
+void lora_get_status(struct lora_status_t *status);
 
 /* Callback on LoRa downlink message */
 void lora_message_callback(uint8_t port, const uint8_t *data, uint8_t len);
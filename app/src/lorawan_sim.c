@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#define DT_DRV_COMPAT lora_hacks_lorawan_sim
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/init.h>
+#include <zephyr/lorawan/lorawan.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/slist.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+#include "lorawan_sim_bottom.h"
+#include "settings.h"
+
+LOG_MODULE_REGISTER(lorawan_sim, CONFIG_APP_LORAWAN_SIM_LOG_LEVEL);
+
+/*
+ * Fake network server protocol, one UDP datagram each way (multi-byte values little endian):
+ *  join:          [0x01][dev eui (8)][join eui (8)]
+ *  join accept:   [0x81][status (0 = accepted)][datarate]
+ *  uplink:        [0x02][dev eui (8)][frame counter (4)][port][flags][datarate][payload]
+ *  uplink result: [0x82][flags][datarate][rssi (2)][snr][port (0 = no data)][payload]
+ * Uplink flags: bit 0 confirmed. Uplink result flags: bit 0 acked, bit 1 data pending.
+ */
+#define SIM_MESSAGE_JOIN 0x01
+#define SIM_MESSAGE_UPLINK 0x02
+#define SIM_MESSAGE_JOIN_ACCEPT 0x81
+#define SIM_MESSAGE_UPLINK_RESULT 0x82
+
+#define SIM_JOIN_SIZE (1 + LORA_DEV_EUI_SIZE + LORA_JOIN_EUI_SIZE)
+#define SIM_JOIN_ACCEPT_SIZE 3
+#define SIM_UPLINK_HEADER_SIZE (1 + LORA_DEV_EUI_SIZE + 4 + 3)
+#define SIM_UPLINK_RESULT_HEADER_SIZE 7
+#define SIM_MAX_PAYLOAD_SIZE 242
+
+#define SIM_UPLINK_FLAG_CONFIRMED BIT(0)
+#define SIM_RESULT_FLAG_ACKED BIT(0)
+#define SIM_RESULT_FLAG_DATA_PENDING BIT(1)
+
+/* Simulated time taken by a join (join accept delays) and an uplink (receive windows) */
+#define SIM_JOIN_TIME K_SECONDS(6)
+#define SIM_UPLINK_TIME K_SECONDS(2)
+
+/* Link quality reported in loopback mode */
+#define SIM_LOOPBACK_RSSI -80
+#define SIM_LOOPBACK_SNR 8
+
+/* EU868 maximum application payload size per datarate */
+static const uint8_t max_payload_sizes[] = { 51, 51, 51, 115, 222, 222, 222, 222 };
+
+static K_MUTEX_DEFINE(sim_lock);
+static sys_slist_t downlink_callbacks = SYS_SLIST_STATIC_INIT(&downlink_callbacks);
+static void (*datarate_changed_cb)(enum lorawan_datarate datarate);
+static uint8_t dev_eui[LORA_DEV_EUI_SIZE];
+static enum lorawan_datarate datarate = LORAWAN_DR_0;
+static enum lorawan_datarate reported_datarate = LORAWAN_DR_0;
+static uint32_t frame_counter;
+static bool adr_enabled;
+static bool started;
+static bool joined;
+
+#ifndef CONFIG_APP_LORAWAN_SIM_LOOPBACK
+static int server_fd = -1;
+static uint8_t response[SIM_UPLINK_RESULT_HEADER_SIZE + SIM_MAX_PAYLOAD_SIZE];
+#endif
+
+static void sim_datarate_observe(enum lorawan_datarate new_datarate)
+{
+	datarate = new_datarate;
+
+	if (datarate != reported_datarate) {
+		reported_datarate = datarate;
+
+		if (datarate_changed_cb != NULL) {
+			datarate_changed_cb(datarate);
+		}
+	}
+}
+
+static void sim_downlink(uint8_t port, bool data_pending, int16_t rssi, int8_t snr, uint8_t len,
+			 const uint8_t *data)
+{
+	struct lorawan_downlink_cb *cb;
+
+	/* As with the LoRaWAN stack, acks without data are reported on port 0 */
+	SYS_SLIST_FOR_EACH_CONTAINER(&downlink_callbacks, cb, node) {
+		if (cb->port == LW_RECV_PORT_ANY || cb->port == port) {
+			cb->cb(port, data_pending, rssi, snr, len, data);
+		}
+	}
+}
+
+int lorawan_start(void)
+{
+	started = true;
+
+	return 0;
+}
+
+int lorawan_join(const struct lorawan_join_config *config)
+{
+	int rc = 0;
+#ifndef CONFIG_APP_LORAWAN_SIM_LOOPBACK
+	uint8_t request[SIM_JOIN_SIZE];
+#endif
+
+	if (started == false) {
+		return -EPERM;
+	} else if (config->mode != LORAWAN_ACT_OTAA) {
+		return -ENOTSUP;
+	}
+
+	k_mutex_lock(&sim_lock, K_FOREVER);
+	memcpy(dev_eui, config->dev_eui, sizeof(dev_eui));
+	joined = false;
+	k_sleep(SIM_JOIN_TIME);
+
+#ifdef CONFIG_APP_LORAWAN_SIM_LOOPBACK
+	joined = true;
+#else
+	request[0] = SIM_MESSAGE_JOIN;
+	memcpy(&request[1], config->dev_eui, LORA_DEV_EUI_SIZE);
+	memcpy(&request[1 + LORA_DEV_EUI_SIZE], config->otaa.join_eui, LORA_JOIN_EUI_SIZE);
+
+	rc = lorawan_sim_bottom_exchange(server_fd, request, sizeof(request), response,
+					 sizeof(response), CONFIG_APP_LORAWAN_SIM_SERVER_TIMEOUT);
+
+	if (rc < 0) {
+		rc = -EIO;
+	} else if (rc < SIM_JOIN_ACCEPT_SIZE || response[0] != SIM_MESSAGE_JOIN_ACCEPT ||
+		   response[1] != 0) {
+		/* No join accept received */
+		rc = -ETIMEDOUT;
+	} else {
+		rc = 0;
+		joined = true;
+		sim_datarate_observe(response[2]);
+	}
+#endif
+
+	if (joined == true) {
+		frame_counter = 0;
+		LOG_INF("Joined, datarate %d", datarate);
+	}
+
+	k_mutex_unlock(&sim_lock);
+
+	return rc;
+}
+
+int lorawan_send(uint8_t port, uint8_t *data, uint8_t len, enum lorawan_message_type type)
+{
+	int rc = 0;
+	bool confirmed = (type == LORAWAN_MSG_CONFIRMED);
+#ifndef CONFIG_APP_LORAWAN_SIM_LOOPBACK
+	uint8_t request[SIM_UPLINK_HEADER_SIZE + SIM_MAX_PAYLOAD_SIZE];
+	uint8_t pos = 0;
+#endif
+
+	if (joined == false) {
+		return -EAGAIN;
+	} else if (len > max_payload_sizes[MIN(datarate, ARRAY_SIZE(max_payload_sizes) - 1)]) {
+		return -EMSGSIZE;
+	}
+
+	k_mutex_lock(&sim_lock, K_FOREVER);
+	LOG_DBG("Uplink %u on port %d, %d bytes, %sconfirmed", frame_counter, port, len,
+		(confirmed ? "" : "un"));
+	k_sleep(SIM_UPLINK_TIME);
+
+#ifdef CONFIG_APP_LORAWAN_SIM_LOOPBACK
+	if (confirmed == true) {
+		sim_downlink(0, false, SIM_LOOPBACK_RSSI, SIM_LOOPBACK_SNR, 0, NULL);
+	}
+#else
+	request[pos++] = SIM_MESSAGE_UPLINK;
+	memcpy(&request[pos], dev_eui, sizeof(dev_eui));
+	pos += sizeof(dev_eui);
+	sys_put_le32(frame_counter, &request[pos]);
+	pos += sizeof(frame_counter);
+	request[pos++] = port;
+	request[pos++] = (confirmed ? SIM_UPLINK_FLAG_CONFIRMED : 0);
+	request[pos++] = datarate;
+	memcpy(&request[pos], data, len);
+
+	rc = lorawan_sim_bottom_exchange(server_fd, request, (pos + len), response,
+					 sizeof(response), CONFIG_APP_LORAWAN_SIM_SERVER_TIMEOUT);
+
+	if (rc < 0) {
+		rc = -EIO;
+	} else if (rc >= SIM_UPLINK_RESULT_HEADER_SIZE && response[0] == SIM_MESSAGE_UPLINK_RESULT) {
+		uint8_t flags = response[1];
+		int16_t rssi = (int16_t)sys_get_le16(&response[3]);
+		int8_t snr = (int8_t)response[5];
+		uint8_t downlink_port = response[6];
+		uint8_t downlink_size = (rc - SIM_UPLINK_RESULT_HEADER_SIZE);
+
+		if (confirmed == true && !(flags & SIM_RESULT_FLAG_ACKED)) {
+			rc = -ETIMEDOUT;
+		} else {
+			rc = 0;
+		}
+
+		if (adr_enabled == true) {
+			sim_datarate_observe(response[2]);
+		}
+
+		if ((flags & SIM_RESULT_FLAG_ACKED) || downlink_port != 0) {
+			sim_downlink(downlink_port, (flags & SIM_RESULT_FLAG_DATA_PENDING), rssi, snr,
+				     downlink_size, &response[SIM_UPLINK_RESULT_HEADER_SIZE]);
+		}
+	} else {
+		/* Nothing received in the receive windows, only a failure if an ack was needed */
+		rc = (confirmed == true ? -ETIMEDOUT : 0);
+	}
+#endif
+
+	++frame_counter;
+	k_mutex_unlock(&sim_lock);
+
+	return rc;
+}
+
+void lorawan_register_downlink_callback(struct lorawan_downlink_cb *cb)
+{
+	sys_slist_append(&downlink_callbacks, &cb->node);
+}
+
+void lorawan_register_dr_changed_callback(void (*dr_cb)(enum lorawan_datarate))
+{
+	datarate_changed_cb = dr_cb;
+}
+
+int lorawan_set_datarate(enum lorawan_datarate dr)
+{
+	/* As with the LoRaWAN stack, the datarate is controlled by the network when ADR is on */
+	if (adr_enabled == true) {
+		return -EINVAL;
+	}
+
+	datarate = dr;
+
+	return 0;
+}
+
+void lorawan_enable_adr(bool enable)
+{
+	adr_enabled = enable;
+}
+
+void lorawan_get_payload_sizes(uint8_t *max_next_payload_size, uint8_t *max_payload_size)
+{
+	*max_payload_size = max_payload_sizes[MIN(datarate, ARRAY_SIZE(max_payload_sizes) - 1)];
+	*max_next_payload_size = *max_payload_size;
+}
+
+static int lorawan_sim_key_provision(enum setting_id_t id, const char *hex)
+{
+	uint8_t key[LORA_APP_KEY_SIZE];
+	uint8_t size = setting_size(id);
+
+	if (hex2bin(hex, strlen(hex), key, sizeof(key)) != size) {
+		LOG_ERR("Invalid simulated key %s", setting_name(id));
+		return -EINVAL;
+	}
+
+	return setting_set(id, key, size);
+}
+
+/* Store the simulated keys if the device has not been provisioned */
+static int lorawan_sim_provision(void)
+{
+	int rc;
+	uint8_t current[LORA_DEV_EUI_SIZE] = { 0 };
+	uint8_t empty_check[LORA_DEV_EUI_SIZE] = { 0 };
+
+	lora_keys_load();
+	lora_keys_get_dev_eui(current);
+
+	if (memcmp(current, empty_check, sizeof(current)) != 0) {
+		return 0;
+	}
+
+	LOG_INF("Storing simulated LoRaWAN keys");
+
+	/* Write all keys in one pass */
+	setting_transaction_begin();
+	rc = lorawan_sim_key_provision(SETTING_ID_LORA_DEV_EUI, CONFIG_APP_LORAWAN_SIM_DEV_EUI);
+
+	if (rc == 0) {
+		rc = lorawan_sim_key_provision(SETTING_ID_LORA_JOIN_EUI,
+					       CONFIG_APP_LORAWAN_SIM_JOIN_EUI);
+	}
+
+	if (rc == 0) {
+		rc = lorawan_sim_key_provision(SETTING_ID_LORA_APP_KEY,
+					       CONFIG_APP_LORAWAN_SIM_APP_KEY);
+	}
+
+	if (rc == 0) {
+		rc = setting_transaction_commit();
+	} else {
+		(void)setting_transaction_commit();
+	}
+
+	if (rc != 0) {
+		LOG_ERR("Simulated LoRaWAN keys store failed: %d", rc);
+	}
+
+	return rc;
+}
+
+SYS_INIT(lorawan_sim_provision, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+/* Device used as the lora0 alias so that the application checks it the same as a radio */
+static int lorawan_sim_init(const struct device *dev)
+{
+#ifndef CONFIG_APP_LORAWAN_SIM_LOOPBACK
+	server_fd = lorawan_sim_bottom_open(CONFIG_APP_LORAWAN_SIM_SERVER_ADDRESS,
+					    CONFIG_APP_LORAWAN_SIM_SERVER_PORT);
+
+	if (server_fd < 0) {
+		LOG_ERR("Fake network server socket open failed");
+		return -EIO;
+	}
+#endif
+
+	return 0;
+}
+
+DEVICE_DT_INST_DEFINE(0, lorawan_sim_init, NULL, NULL, NULL, POST_KERNEL,
+		      CONFIG_APPLICATION_INIT_PRIORITY, NULL);
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "lorawan_sim_bottom.h"
+
+int lorawan_sim_bottom_open(const char *address, uint16_t port)
+{
+	int fd;
+	struct sockaddr_in server = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+	};
+
+	if (inet_pton(AF_INET, address, &server.sin_addr) != 1) {
+		return -1;
+	}
+
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+	if (fd < 0) {
+		return -1;
+	}
+
+	/* Connected so that only datagrams from the server are received */
+	if (connect(fd, (struct sockaddr *)&server, sizeof(server)) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+int lorawan_sim_bottom_exchange(int fd, const uint8_t *request, size_t request_size,
+				uint8_t *response, size_t response_size, int timeout_ms)
+{
+	struct pollfd poll_fd = {
+		.fd = fd,
+		.events = POLLIN,
+	};
+	ssize_t rc;
+
+	/* Discard late responses to earlier requests which timed out */
+	while (recv(fd, response, response_size, MSG_DONTWAIT) >= 0) {
+	}
+
+	if (send(fd, request, request_size, 0) != (ssize_t)request_size) {
+		return -1;
+	}
+
+	rc = poll(&poll_fd, 1, timeout_ms);
+
+	if (rc <= 0) {
+		return (int)rc;
+	}
+
+	rc = recv(fd, response, response_size, 0);
+
+	return (rc < 0 ? -1 : (int)rc);
+}
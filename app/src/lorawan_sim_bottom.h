@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_LORAWAN_SIM_BOTTOM_H
+#define APP_LORAWAN_SIM_BOTTOM_H
+
+/*
+ * Host side of the simulated LoRaWAN backend, built into the native simulator runner so that
+ * it can use the host's sockets. Only plain C types are used as this header is shared with
+ * the Zephyr side.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Open a UDP socket to the fake network server, returns the socket or -1 on error */
+int lorawan_sim_bottom_open(const char *address, uint16_t port);
+
+/* Send a request and wait up to timeout_ms (host time) for the response, returns the size of
+ * the response, 0 if there was no response or -1 on error
+ */
+int lorawan_sim_bottom_exchange(int fd, const uint8_t *request, size_t request_size,
+				uint8_t *response, size_t response_size, int timeout_ms);
+
+#endif /* APP_LORAWAN_SIM_BOTTOM_H */
@@ -10,6 +10,8 @@
 #include <zephyr/sys/reboot.h>
 #include <zephyr/storage/flash_map.h>
 #include <zephyr/sys_clock.h>
+#include <zephyr/sys/byteorder.h>
+#include "app.h"
 #include "settings.h"
 #include "sensor.h"
 #include "lora.h"
@@ -21,7 +23,18 @@
 #include "garage.h"
 #include "hfclk.h"
 #include "watchdog.h"
-#include "error_messages.h"
+#include "uplink_queue.h"
+#include "readings.h"
+#include "report_on_change.h"
+#include "backlog.h"
+#include "protocol.h"
+#include "downlink.h"
+#include "frame_packer.h"
+#include "energy.h"
+#include "trace.h"
+#include "telemetry.h"
+#include "flash_maintenance.h"
+#include "suspend.h"
 #include "app_version.h"
 
 LOG_MODULE_REGISTER(app, CONFIG_APP_LOG_LEVEL);
@@ -30,76 +43,640 @@ LOG_MODULE_REGISTER(app, CONFIG_APP_LOG_LEVEL);
 #define SENSOR_READING_TIME_MAX 7200
 #define SEND_ATTEMPTS 3
 #define ADC_OFFSET_DEFAULT_MV 500
+#define FRAME_MAX_QUEUED_RECORDS 16
 
 extern void sys_arch_reboot(int type);
 
-enum lora_uplink_types {
-	LORA_UPLINK_TYPE_STARTUP,
-	LORA_UPLINK_TYPE_READINGS,
-	LORA_UPLINK_TYPE_ERROR_READINGS,
-	LORA_UPLINK_TYPE_ERROR_ADC,
-	LORA_UPLINK_TYPE_ERROR_NO_HANDLER,
-	LORA_UPLINK_TYPE_UPTIME,
-	LORA_UPLINK_TYPE_IR_COMPLETE,
-	LORA_UPLINK_TYPE_GARAGE_COMPLETE,
-};
-
-enum lora_downlink_types {
-	LORA_DOWNLINK_TYPE_IR,
-	LORA_DOWNLINK_TYPE_UNUSED,
-	LORA_DOWNLINK_TYPE_GARAGE,
-	LORA_DOWNLINK_TYPE_BLUETOOTH,
-	LORA_DOWNLINK_TYPE_DEVICE,
-};
-
-enum device_command_op_t {
-	DEVICE_COMMAND_OP_REBOOT,
-	DEVICE_COMMAND_OP_CLEAR_SETTINGS,
-	DEVICE_COMMAND_OP_BLINK_LED,
-	DEVICE_COMMAND_OP_GET_UPTIME,
-	DEVICE_COMMAND_OP_SET_SENSOR_INTEVAL,
+enum app_event_t {
+	APP_EVENT_SENSOR_TIMER = BIT(0),
+	APP_EVENT_MESSAGE_QUEUED = BIT(1),
+	APP_EVENT_UPTIME = BIT(2),
+	APP_EVENT_SUSPEND = BIT(3),
 
-	DEVICE_COMMAND_OP_COUNT,
-};
-
-enum send_flags_t {
-	SEND_FLAG_UPTIME = 0x01,
+	APP_EVENT_ALL = (APP_EVENT_SENSOR_TIMER | APP_EVENT_MESSAGE_QUEUED | APP_EVENT_UPTIME |
+			 APP_EVENT_SUSPEND),
 };
 
 static void sensor_timer_handler(struct k_timer *dummy);
 
 static uint16_t sensor_reading_time = CONFIG_APP_DEFAULT_SENSOR_READING_TIME;
-static uint8_t send_flags = 0;
-static K_SEM_DEFINE(send_message_sem, 1, 2);
+static uint8_t failed_messages = 0;
+static uint16_t reported_drops = 0;
+static K_EVENT_DEFINE(app_events);
 static K_TIMER_DEFINE(sensor_timer, sensor_timer_handler, NULL);
+static k_ticks_t next_reading_ticks;
+static atomic_t readings_enabled = ATOMIC_INIT(1);
+
+#ifdef CONFIG_APP_SUSPEND
+static atomic_t suspend_wake_time = ATOMIC_INIT(0);
+#endif
+
+#if CONFIG_APP_SAMPLE_JITTER > 0
+static uint32_t jitter_state;
+#endif
+
+#if CONFIG_APP_TELEMETRY_INTERVAL > 0
+static uint8_t telemetry_readings = 0;
+#endif
+
+static uint8_t frame_data[LORA_MAX_PAYLOAD_SIZE + FRAME_PACKER_OVERHEAD];
+
+#ifdef CONFIG_APP_READINGS_BATCH
+static uint8_t readings_data[LORA_MAX_PAYLOAD_SIZE];
+
+#ifdef CONFIG_APP_READINGS_COMPACT
+#define READINGS_UPLINK_TYPE LORA_UPLINK_TYPE_READINGS_COMPACT
+#else
+#define READINGS_UPLINK_TYPE LORA_UPLINK_TYPE_READINGS_BATCH
+#endif
+#endif
 
 static void sensor_timer_handler(struct k_timer *dummy)
 {
-	k_sem_give(&send_message_sem);
+	k_event_post(&app_events, APP_EVENT_SENSOR_TIMER);
+}
+
+#if CONFIG_APP_SAMPLE_JITTER > 0
+static uint32_t schedule_random(void)
+{
+	/* xorshift32, only used to spread transmissions so does not need to be secure */
+	jitter_state ^= jitter_state << 13;
+	jitter_state ^= jitter_state >> 17;
+	jitter_state ^= jitter_state << 5;
+
+	return jitter_state;
+}
+#endif
+
+static void sensor_timer_start(void)
+{
+	k_ticks_t jitter = 0;
+
+#if CONFIG_APP_SAMPLE_JITTER > 0
+	jitter = k_ms_to_ticks_ceil64(schedule_random() % (CONFIG_APP_SAMPLE_JITTER * MSEC_PER_SEC));
+#endif
+
+	/* Jitter is applied to this reading only and is not added to the schedule */
+	k_timer_start(&sensor_timer, K_TIMEOUT_ABS_TICKS(next_reading_ticks + jitter), K_NO_WAIT);
+}
+
+static void schedule_init(void)
+{
+	uint32_t offset = 0;
+
+#ifdef CONFIG_APP_SAMPLE_PHASE_OFFSET
+	uint8_t dev_eui[LORA_DEV_EUI_SIZE] = { 0 };
+	uint32_t hash = 2166136261U;
+	uint8_t i = 0;
+
+	/* FNV-1a hash of dev EUI gives each device a fixed phase within the period */
+	lora_keys_get_dev_eui(dev_eui);
+
+	while (i < sizeof(dev_eui)) {
+		hash ^= dev_eui[i];
+		hash *= 16777619U;
+		++i;
+	}
+
+	offset = hash % sensor_reading_time;
+
+#if CONFIG_APP_SAMPLE_JITTER > 0
+	jitter_state = hash;
+#endif
+#endif
+
+#if CONFIG_APP_SAMPLE_JITTER > 0
+	jitter_state ^= k_cycle_get_32();
+
+	if (jitter_state == 0) {
+		jitter_state = 1;
+	}
+#endif
+
+	next_reading_ticks = k_uptime_ticks() + k_sec_to_ticks_ceil64(offset);
+	sensor_timer_start();
+}
+
+static void schedule_next(void)
+{
+	k_ticks_t period = k_sec_to_ticks_ceil64(sensor_reading_time);
+	k_ticks_t now = k_uptime_ticks();
+
+	/* Schedule is anchored to an absolute time so time spent sending does not cause drift */
+	next_reading_ticks += period;
+
+	if (next_reading_ticks <= now) {
+		/* Sending took longer than the period, skip missed readings but keep the phase */
+		next_reading_ticks += ((now - next_reading_ticks) / period + 1) * period;
+	}
+
+	sensor_timer_start();
+}
+
+void app_readings_enable(bool enable)
+{
+	(void)atomic_set(&readings_enabled, (enable == true ? 1 : 0));
 }
 
+void app_get_status(struct app_status_t *status)
+{
+	status->readings_enabled = (atomic_get(&readings_enabled) != 0);
+	status->sensor_reading_time = sensor_reading_time;
+}
+
+#ifdef CONFIG_APP_SUSPEND
+void app_suspend(uint32_t wake_time)
+{
+	(void)atomic_set(&suspend_wake_time, (atomic_val_t)wake_time);
+	k_event_post(&app_events, APP_EVENT_SUSPEND);
+}
+#endif
+
 void lora_message_added(void)
 {
-	k_sem_give(&send_message_sem);
+	k_event_post(&app_events, APP_EVENT_MESSAGE_QUEUED);
 }
 
-int main(void)
+/* Messages deferred due to the airtime budget are not counted as link failures */
+static void message_failed(int rc)
+{
+	if (rc != -EAGAIN) {
+		++failed_messages;
+	}
+}
+
+/* Send an application record (type followed by data), with as many queued application messages
+ * as will fit in the same frame. Queued messages are removed if the frame is sent
+ */
+static int send_frame(const uint8_t *record, uint8_t record_size,
+		      enum lora_traffic_class_t traffic_class, bool confirmed)
+{
+	int rc;
+	struct frame_packer_t packer;
+	uint8_t frame_size;
+
+#ifdef CONFIG_APP_UPLINK_PACKING
+	struct uplink_queue_entry_t *entries[FRAME_MAX_QUEUED_RECORDS];
+	uint8_t entry_count = 0;
+	uint8_t i = 0;
+#endif
+
+	frame_packer_init(&packer, frame_data, lora_get_max_payload_size());
+
+	if (record_size > 0) {
+		rc = frame_packer_add(&packer, record, record_size);
+
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
+#ifdef CONFIG_APP_UPLINK_PACKING
+	while (entry_count < ARRAY_SIZE(entries)) {
+		struct uplink_queue_entry_t *entry;
+
+		entry = uplink_queue_get_fitting(LORA_APP_PORT, frame_packer_space(&packer));
+
+		if (entry == NULL) {
+			break;
+		}
+
+		(void)frame_packer_add(&packer, entry->data, entry->data_size);
+
+		if (entry->flags & UPLINK_QUEUE_FLAG_CONFIRMED) {
+			confirmed = true;
+		}
+
+		entries[entry_count++] = entry;
+	}
+#endif
+
+	frame_size = frame_packer_finish(&packer);
+
+	if (frame_size == 0) {
+		return -ENODATA;
+	}
+
+	rc = lora_send_message(LORA_APP_PORT, traffic_class, frame_data, frame_size, confirmed,
+			       SEND_ATTEMPTS);
+
+#ifdef CONFIG_APP_UPLINK_PACKING
+	while (i < entry_count) {
+		if (rc == 0) {
+			uplink_queue_remove(entries[i]);
+		} else if (rc == -EAGAIN) {
+			uplink_queue_deferred(entries[i]);
+		} else {
+			(void)uplink_queue_failed(entries[i]);
+		}
+
+		++i;
+	}
+
+	if (entry_count > 0) {
+		LOG_DBG("%d queued messages packed in frame", entry_count);
+	}
+#endif
+
+	return rc;
+}
+
+static int send_startup(void)
+{
+	int rc;
+	uint8_t lora_data[PAYLOAD_UPLINK_STARTUP_SIZE];
+	uint8_t data_size;
+
+	/* Send connect message with version, application type and payload schema version */
+	data_size = payload_uplink_startup_encode(lora_data, APP_VERSION_MAJOR, APP_VERSION_MINOR,
+						  APP_PATCHLEVEL, APP_TWEAK, CONFIG_APP_TYPE,
+						  PAYLOAD_SCHEMA_VERSION);
+
+	rc = send_frame(lora_data, data_size, LORA_TRAFFIC_CLASS_READINGS, true);
+
+	if (rc == 0) {
+		LOG_INF("Connect message sent");
+	} else {
+		LOG_ERR("Connect message failed to send: %d", rc);
+		message_failed(rc);
+	}
+
+	return rc;
+}
+
+static int send_uptime(void)
+{
+	int rc;
+
+#ifdef CONFIG_APP_TELEMETRY
+	uint8_t lora_data[PAYLOAD_UPLINK_TELEMETRY_SIZE];
+
+	/* Send device telemetry, which includes the uptime */
+	(void)telemetry_encode(lora_data);
+#else
+	uint8_t lora_data[PAYLOAD_UPLINK_UPTIME_SIZE];
+
+	/* Send device uptime */
+	(void)payload_uplink_uptime_encode(lora_data, (uint32_t)(k_uptime_get() / MSEC_PER_SEC));
+#endif
+
+	rc = send_frame(lora_data, sizeof(lora_data), LORA_TRAFFIC_CLASS_ACK, false);
+
+	if (rc == 0) {
+		LOG_INF("Message sent");
+	} else {
+		LOG_ERR("Message failed to send: %d", rc);
+		message_failed(rc);
+	}
+
+	return rc;
+}
+
+static bool send_queued_messages(void)
+{
+	int rc;
+	struct uplink_queue_entry_t *entry;
+	uint16_t drops;
+
+	/* Send queued messages in priority order, stop on first failure and retry on next wake */
+	while ((entry = uplink_queue_get()) != NULL) {
+#ifdef CONFIG_APP_UPLINK_PACKING
+		if (entry->port == LORA_APP_PORT && entry->data_size > 0 &&
+		    entry->data_size <= lora_get_max_payload_size()) {
+			/* Application messages are packed together, starting with this one */
+			uplink_queue_deferred(entry);
+			rc = send_frame(NULL, 0, LORA_TRAFFIC_CLASS_ACK, false);
+
+			if (rc != 0) {
+				LOG_ERR("Message failed to send: %d", rc);
+				message_failed(rc);
+				return false;
+			}
+
+#ifdef CONFIG_APP_WATCHDOG
+			watchdog_feed();
+#endif
+			LOG_INF("Message sent");
+			continue;
+		}
+#endif
+
+		enum lora_traffic_class_t traffic_class = (entry->port == LORA_APP_PORT ?
+							   LORA_TRAFFIC_CLASS_ACK :
+							   LORA_TRAFFIC_CLASS_SMP);
+
+		rc = lora_send_message(entry->port, traffic_class,
+				       (entry->data_size == 0 ? NULL : entry->data), entry->data_size,
+				       (entry->flags & UPLINK_QUEUE_FLAG_CONFIRMED), SEND_ATTEMPTS);
+
+		if (rc == 0) {
+#ifdef CONFIG_APP_WATCHDOG
+			watchdog_feed();
+#endif
+			LOG_INF("Message sent");
+			uplink_queue_remove(entry);
+		} else {
+			LOG_ERR("Message failed to send: %d", rc);
+			message_failed(rc);
+
+			if (rc == -EAGAIN) {
+				uplink_queue_deferred(entry);
+				return false;
+			} else if (uplink_queue_failed(entry) == true) {
+				return false;
+			}
+		}
+	}
+
+	/* Report number of dropped messages if it has changed */
+	drops = uplink_queue_get_drops();
+
+	if (drops != reported_drops) {
+		uint8_t lora_data[PAYLOAD_UPLINK_QUEUE_DROPS_SIZE];
+
+		(void)payload_uplink_queue_drops_encode(lora_data, drops);
+
+		rc = send_frame(lora_data, sizeof(lora_data), LORA_TRAFFIC_CLASS_ACK, false);
+
+		if (rc == 0) {
+			reported_drops = drops;
+		} else {
+			LOG_ERR("Message failed to send: %d", rc);
+			message_failed(rc);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static int send_readings(void)
 {
 	int rc;
-	uint16_t application_type = CONFIG_APP_TYPE;
 	int8_t temperature[2];
 	int8_t humidity[2];
-	uint8_t lora_data[8];
+	uint8_t lora_data[PAYLOAD_UPLINK_READINGS_SIZE];
+	uint8_t data_size = 0;
+	bool adc_failed = false;
+
+	/* Voltage is reported as 0xffff if there is no ADC */
+	uint16_t voltage = 0xffff;
+
+#ifdef CONFIG_APP_READINGS_BATCH
+	uint8_t readings_sent;
+#endif
+
+#ifdef CONFIG_APP_READINGS_BACKLOG
+	uint32_t reading_time;
+
+	/* Sending can take a while with retries, the reading time is when it was taken */
+	reading_time = (uint32_t)(k_uptime_get() / MSEC_PER_SEC);
+#endif
+
+	trace_enter(TRACE_POINT_SENSOR_FETCH);
+	rc = sensor_fetch_readings(temperature, humidity);
+	trace_exit(TRACE_POINT_SENSOR_FETCH, rc);
+
+#ifdef CONFIG_ADC
+	if (rc == 0) {
+		trace_enter(TRACE_POINT_ADC_READ);
+		rc = adc_read_internal(&voltage);
+		trace_exit(TRACE_POINT_ADC_READ, rc);
+
+		if (rc != 0) {
+			adc_failed = true;
+		} else {
+#ifdef CONFIG_APP_EXTERNAL_DCDC
+			int16_t adc_offset = app_keys_get_power_offset();
+
+			if (adc_offset == 0) {
+				/* No offset, use default */
+				adc_offset = ADC_OFFSET_DEFAULT_MV;
+			}
+
+			voltage += adc_offset;
+#endif
+			telemetry_voltage(voltage);
+		}
+	}
+#endif
+
+#ifdef CONFIG_APP_REPORT_ON_CHANGE
+	if (rc == 0) {
+		if (report_on_change_required(temperature, humidity, voltage) == false) {
+#ifdef CONFIG_APP_WATCHDOG
+			/* Reading was taken successfully, nothing to send */
+			watchdog_feed();
+#endif
+			return 0;
+		}
+
+#ifdef CONFIG_APP_READINGS_BATCH
+		/* Reading is buffered, so consider it reported */
+		report_on_change_sent(temperature, humidity, voltage);
+#endif
+	}
+#endif
+
+#ifdef CONFIG_APP_READINGS_BATCH
+	if (rc == 0) {
+		readings_add(temperature, humidity, voltage, sensor_reading_time);
+
+		if (readings_flush_required() == false) {
+#ifdef CONFIG_APP_WATCHDOG
+			/* Reading was taken successfully, nothing to send yet */
+			watchdog_feed();
+#endif
+			return 0;
+		}
+
+		data_size = readings_encode(READINGS_UPLINK_TYPE, sensor_reading_time,
+					    readings_data, lora_get_max_payload_size(),
+					    &readings_sent);
+
+		if (data_size == 0) {
+#ifdef CONFIG_APP_WATCHDOG
+			/* Reading was taken successfully, readings are kept until they can be sent */
+			watchdog_feed();
+#endif
+			return 0;
+		}
+
+		rc = send_frame(readings_data, data_size, LORA_TRAFFIC_CLASS_READINGS, false);
+
+		if (rc == 0) {
+#ifdef CONFIG_APP_WATCHDOG
+			watchdog_feed();
+#endif
+			LOG_INF("%d readings sent", readings_sent);
+			readings_remove(readings_sent);
+		} else {
+			LOG_ERR("Readings failed to send: %d", rc);
+			message_failed(rc);
+		}
+
+		return rc;
+	}
+#endif
+
+	if (rc == 0) {
+		data_size = payload_uplink_readings_encode(lora_data, temperature[0], temperature[1],
+							   humidity[0], humidity[1], voltage);
+	} else {
+		LOG_ERR("Failed to fetch sensor readings or ADC value");
+
+		if (adc_failed) {
+			data_size = payload_uplink_error_adc_encode(lora_data, (int8_t)rc);
+		} else {
+			data_size = payload_uplink_error_readings_encode(lora_data, (int8_t)rc);
+		}
+	}
+
+	rc = send_frame(lora_data, data_size, LORA_TRAFFIC_CLASS_READINGS, false);
+
+	if (rc == 0) {
+#ifdef CONFIG_APP_WATCHDOG
+		watchdog_feed();
+#endif
+		LOG_INF("Message sent");
+
+#if defined(CONFIG_APP_REPORT_ON_CHANGE) && !defined(CONFIG_APP_READINGS_BATCH)
+		if (lora_data[0] == LORA_UPLINK_TYPE_READINGS) {
+			report_on_change_sent(temperature, humidity, voltage);
+		}
+#endif
+	} else {
+		LOG_ERR("Message failed to send: %d", rc);
+		message_failed(rc);
+
+#ifdef CONFIG_APP_READINGS_BACKLOG
+		if (lora_data[0] == LORA_UPLINK_TYPE_READINGS) {
+			struct reading_t reading = {
+				.temperature = { temperature[0], temperature[1] },
+				.humidity = { humidity[0], humidity[1] },
+				.voltage = voltage,
+			};
+
+			backlog_add(&reading, reading_time, sensor_reading_time);
+		}
+#endif
+	}
+
+	return rc;
+}
+
+#ifdef CONFIG_APP_READINGS_BACKLOG
+static void send_backlog(void)
+{
+	int rc;
+	struct reading_t readings[CONFIG_APP_READINGS_BACKLOG_BATCH];
+	uint8_t lora_data[PAYLOAD_UPLINK_READINGS_BACKFILL_AGED_SIZE +
+			  (CONFIG_APP_READINGS_BACKLOG_BATCH * READINGS_ENTRY_SIZE)];
 	uint8_t data_size;
-	uint8_t failed_messages = 0;
+	uint8_t count;
+	uint32_t age;
+	uint16_t interval;
+	uint8_t i = 0;
+
+	rc = backlog_get(readings, ARRAY_SIZE(readings), &count, &age, &interval);
+
+	if (rc == -EINVAL) {
+		/* Record cannot be sent, remove it so it does not block the backlog */
+		(void)backlog_remove();
+		return;
+	} else if (rc != 0) {
+		return;
+	}
+
+	data_size = payload_uplink_readings_backfill_aged_encode(lora_data, interval, age, count);
+
+	while (i < count) {
+		readings_put_entry(&readings[i], &lora_data[data_size]);
+		data_size += READINGS_ENTRY_SIZE;
+		++i;
+	}
+
+	rc = send_frame(lora_data, data_size, LORA_TRAFFIC_CLASS_READINGS, false);
+
+	if (rc == 0) {
+		LOG_INF("%d backlog readings sent", count);
+		(void)backlog_remove();
+	} else {
+		LOG_ERR("Backlog failed to send: %d", rc);
+		message_failed(rc);
+	}
+}
+
+static void store_unsent_readings(void)
+{
+#ifdef CONFIG_APP_READINGS_BATCH
+	struct reading_t reading;
+	uint8_t i = 0;
+
+	while (readings_get(i, &reading) == 0) {
+		backlog_add(&reading, readings_get_time(i), sensor_reading_time);
+		++i;
+	}
+
+	readings_remove(i);
+#endif
+
+	(void)backlog_flush();
+}
+#endif
+
+#ifdef CONFIG_APP_SUSPEND
+/* Stop sampling and advertising, the LoRaWAN session is kept in NVM settings so a wake from
+ * System OFF (a reset) does not need to rejoin
+ */
+static void suspend_device(void)
+{
+	uint32_t wake_time = (uint32_t)atomic_get(&suspend_wake_time);
+
+	LOG_INF("Suspending");
+	k_timer_stop(&sensor_timer);
+	k_event_clear(&app_events, APP_EVENT_SENSOR_TIMER);
+
+#ifdef CONFIG_BT
+	bluetooth_suspend(true);
+#endif
+
+	if (wake_time == 0) {
+#ifdef CONFIG_APP_READINGS_BACKLOG
+		store_unsent_readings();
+#endif
+		suspend_system_off();
+	}
+
+	suspend_wait(wake_time);
+
+#ifdef CONFIG_BT
+	bluetooth_suspend(false);
+#endif
+
+	LOG_INF("Resuming");
+	schedule_init();
+}
+#endif
+
+static void reboot_device(void)
+{
+#ifdef CONFIG_APP_READINGS_BACKLOG
+	store_unsent_readings();
+#endif
+	watchdog_fatal();
+	sys_arch_reboot(SYS_REBOOT_COLD);
+}
+
+int main(void)
+{
+	int rc;
+	uint32_t pending_events = 0;
 	bool lora_joined = false;
 	bool lora_sent_join_message = false;
+	bool lora_rejoining = false;
 	bool error = false;
 
-#ifdef CONFIG_ADC
-	uint16_t voltage;
-#endif
-
 	LOG_INF("Application version %s, built " __DATE__, APP_VERSION_EXTENDED_STRING);
 
 	peripheral_setup();
@@ -107,6 +684,23 @@ int main(void)
 	lora_keys_load();
 	app_keys_load();
 
+#ifdef CONFIG_APP_FLASH_MAINTENANCE
+	/* Before other setup which writes to flash, so that those writes are measured */
+	(void)flash_maintenance_init();
+#endif
+
+#ifdef CONFIG_APP_TELEMETRY
+	telemetry_init();
+#endif
+
+#ifdef CONFIG_APP_READINGS_BACKLOG
+	(void)backlog_init();
+#endif
+
+#ifdef CONFIG_APP_SUSPEND
+	(void)suspend_init();
+#endif
+
 #ifdef CONFIG_APP_GARAGE_DOOR
 	garage_init();
 #endif
@@ -170,185 +764,123 @@ int main(void)
 		led_off(LED_RED);
 	}
 
+	/* First reading is taken at this device's phase offset so that devices which power up
+	 * together do not all transmit together
+	 */
+	schedule_init();
+
 	while (1) {
-		uint8_t i = 0;
-		uint8_t l;
+		uint32_t events;
+
+		/* Only carry out work for the events that have been raised, pending events which
+		 * failed (e.g. due to not being joined) are retried on the next wake
+		 */
+		events = k_event_wait(&app_events, APP_EVENT_ALL, false, K_FOREVER);
+		k_event_clear(&app_events, events);
+		pending_events |= events;
+		trace_enter(TRACE_POINT_WAKE);
+
+#if CONFIG_APP_TELEMETRY_INTERVAL > 0
+		if (events & APP_EVENT_SENSOR_TIMER) {
+			++telemetry_readings;
+
+			if (telemetry_readings >= CONFIG_APP_TELEMETRY_INTERVAL) {
+				/* Periodic telemetry is sent the same way as a requested one */
+				telemetry_readings = 0;
+				pending_events |= APP_EVENT_UPTIME;
+			}
+		}
+#endif
 
-		k_sem_take(&send_message_sem, K_FOREVER);
 		(void)hfclk_enable();
 
 		if (lora_joined == false) {
-			rc = lora_setup();
+			rc = (lora_rejoining == true ? lora_rejoin() : lora_setup());
 
 			if (rc == 0) {
 				lora_joined = true;
+			} else if (rc == -ECONNABORTED) {
+				/* Rejoining has not restored the connection, reboot as a last resort */
+				reboot_device();
 			} else {
 				goto wait;
 			}
 		}
 
 		if (lora_sent_join_message == false) {
-			/* Send connect message with version and application type */
-			data_size = 0;
-			lora_data[data_size++] = LORA_UPLINK_TYPE_STARTUP;
-			lora_data[data_size++] = APP_VERSION_MAJOR;
-			lora_data[data_size++] = APP_VERSION_MINOR;
-			lora_data[data_size++] = APP_PATCHLEVEL;
-			lora_data[data_size++] = APP_TWEAK;
-			lora_data[data_size++] = ((uint8_t *)&application_type)[0];
-			lora_data[data_size++] = ((uint8_t *)&application_type)[1];
-
-			rc = lora_send_message(lora_data, data_size, true, SEND_ATTEMPTS);
+			rc = send_startup();
 
 			if (rc == 0) {
-				LOG_INF("Connect message sent");
 				lora_sent_join_message = true;
 			} else {
-				LOG_ERR("Connect message failed to send: %d", rc);
-				++failed_messages;
 				goto wait;
 			}
 		}
 
-		if (send_flags & SEND_FLAG_UPTIME) {
-			/* Send device uptime */
-			uint32_t uptime = (uint32_t)(k_uptime_get() / MSEC_PER_SEC);
-
-			lora_data[0] = LORA_UPLINK_TYPE_UPTIME;
-			memcpy(&lora_data[1], &uptime, sizeof(uptime));
-
-			rc = lora_send_message(lora_data, 5, false, SEND_ATTEMPTS);
+		if (pending_events & APP_EVENT_UPTIME) {
+			rc = send_uptime();
 
 			if (rc == 0) {
-				LOG_INF("Message sent");
-				send_flags &= ~SEND_FLAG_UPTIME;
-			} else {
-				LOG_ERR("Message failed to send: %d", rc);
-				++failed_messages;
+				pending_events &= ~APP_EVENT_UPTIME;
 			}
 		}
 
-		/* Check for any error mesages to report */
-		l = error_message_get_count();
-
-		if (l > 0) {
-			const struct error_message_holder_t *errors = error_message_get_array();
-
-			error_message_lock();
-
-			while (i < l) {
-				rc = lora_send_message((errors[i].data_size == 0 ? NULL :
-							errors[i].data), errors[i].data_size,
-						       false, SEND_ATTEMPTS);
-
-				if (rc == 0) {
+		/* Readings are sent before queued messages so that they can share a frame */
+		if ((pending_events & APP_EVENT_SENSOR_TIMER) && atomic_get(&readings_enabled) == 0) {
 #ifdef CONFIG_APP_WATCHDOG
-					watchdog_feed();
+			/* Readings have been disabled from the shell, the device is still working */
+			watchdog_feed();
 #endif
-					LOG_INF("Message sent");
-				} else {
-					LOG_ERR("Message failed to send: %d", rc);
-					++failed_messages;
-				}
-
-				++i;
-			}
-
-			error_message_clear();
-			error_message_unlock();
-
-			/* Ensure that there is a pending timer event or semaphore count so this
-			 * runs again
-			 */
-			if (k_timer_remaining_get(&sensor_timer) == 0 &&
-			    k_sem_count_get(&send_message_sem) == 0) {
-				/* Something has been missed, restart the timer */
-				goto restart_timer;
-			}
-		}
-
-		data_size = 0;
-
-		rc = sensor_fetch_readings(temperature, humidity);
+		} else if (pending_events & APP_EVENT_SENSOR_TIMER) {
+			rc = send_readings();
 
-		if (rc != 0) {
-			lora_data[data_size++] = LORA_UPLINK_TYPE_ERROR_READINGS;
-		}
-
-#ifdef CONFIG_ADC
-		if (rc == 0) {
-			rc = adc_read_internal(&voltage);
-
-			if (rc != 0) {
-				lora_data[data_size++] = LORA_UPLINK_TYPE_ERROR_ADC;
-			} else {
-#ifdef CONFIG_APP_EXTERNAL_DCDC
-				int16_t adc_offset;
-
-				rc = settings_runtime_get("app/power_offset", (uint8_t *)&adc_offset, sizeof(adc_offset));
-
-				if (rc != sizeof(adc_offset) || adc_offset == 0) {
-					/* No offset, use default */
-					adc_offset = ADC_OFFSET_DEFAULT_MV;
-				}
-
-				voltage += adc_offset;
-
-				rc = 0;
-#endif
+#ifdef CONFIG_APP_READINGS_BACKLOG
+			/* Backfill one record of readings per period whilst the link is working */
+			if (rc == 0 && backlog_pending() == true) {
+				send_backlog();
 			}
-		}
-#endif
-
-		if (rc == 0) {
-			lora_data[data_size++] = LORA_UPLINK_TYPE_READINGS;
-			lora_data[data_size++] = temperature[0];
-			lora_data[data_size++] = temperature[1];
-			lora_data[data_size++] = humidity[0];
-			lora_data[data_size++] = humidity[1];
-
-#ifdef CONFIG_ADC
-			lora_data[data_size++] = (voltage & 0xff00) >> 8;
-			lora_data[data_size++] = voltage & 0xff;
-#else
-			lora_data[data_size++] = 0xff;
-			lora_data[data_size++] = 0xff;
 #endif
-		} else {
-			LOG_ERR("Failed to fetch sensor readings or ADC value");
-
-			/* Uplink type is already set, append error code */
-			lora_data[data_size++] = rc & 0xff;
 		}
 
-		rc = lora_send_message(lora_data, data_size, false, SEND_ATTEMPTS);
-
-		if (rc == 0) {
-#ifdef CONFIG_APP_WATCHDOG
-			watchdog_feed();
-#endif
-			LOG_INF("Message sent");
-		} else {
-			LOG_ERR("Message failed to send: %d", rc);
-			++failed_messages;
+		if (pending_events & APP_EVENT_MESSAGE_QUEUED) {
+			if (send_queued_messages() == true) {
+				pending_events &= ~APP_EVENT_MESSAGE_QUEUED;
+			}
 		}
 
 wait:
 		(void)hfclk_disable();
 
+		/* Receive windows of any uplinks are over, write backlog and prepare flash before idle */
+#ifdef CONFIG_APP_READINGS_BACKLOG
+		backlog_idle();
+#endif
+		flash_maintenance_idle();
+		trace_exit(TRACE_POINT_WAKE, 0);
+
 		if (failed_messages > CONFIG_APP_LORA_RECONNECT_FAILED_PACKETS) {
 			/* No successful messages after a period of time, consider connection dead
-			 * and reconnect
+			 * and rejoin on the next wake, without losing application state
 			 */
+			LOG_ERR("Too many failed messages, rejoining");
 			failed_messages = 0;
 			lora_joined = false;
-			lora_sent_join_message = false;
-			watchdog_fatal();
-			sys_arch_reboot(SYS_REBOOT_COLD);
+			lora_rejoining = true;
 		}
 
-restart_timer:
-		k_timer_start(&sensor_timer, K_SECONDS(sensor_reading_time), K_NO_WAIT);
+		if (pending_events & APP_EVENT_SENSOR_TIMER) {
+			/* Readings have been handled (or could not be sent), wait for next slot */
+			pending_events &= ~APP_EVENT_SENSOR_TIMER;
+			schedule_next();
+		}
+
+#ifdef CONFIG_APP_SUSPEND
+		if (pending_events & APP_EVENT_SUSPEND) {
+			/* Readings missed whilst suspended are skipped, sampling restarts on wake */
+			pending_events &= ~(APP_EVENT_SUSPEND | APP_EVENT_SENSOR_TIMER);
+			suspend_device();
+		}
+#endif
 	}
 }
 
@@ -393,11 +925,10 @@ static int device_command(const enum device_command_op_t op, const uint8_t *data
 		}
 		case DEVICE_COMMAND_OP_GET_UPTIME:
 		{
-			send_flags |= SEND_FLAG_UPTIME;
-			k_sem_give(&send_message_sem);
+			k_event_post(&app_events, APP_EVENT_UPTIME);
 			break;
 		}
-		case DEVICE_COMMAND_OP_SET_SENSOR_INTEVAL:
+		case DEVICE_COMMAND_OP_SET_SENSOR_INTERVAL:
 		{
 			const uint16_t *reading_time = (uint16_t *)data;
 
@@ -410,6 +941,43 @@ static int device_command(const enum device_command_op_t op, const uint8_t *data
 			sensor_reading_time = *reading_time;
 			break;
 		}
+#ifdef CONFIG_APP_REPORT_ON_CHANGE
+		case DEVICE_COMMAND_OP_SET_REPORT_ON_CHANGE:
+		{
+			return report_on_change_set(data, data_size);
+		}
+#endif
+#ifdef CONFIG_APP_ENERGY
+		case DEVICE_COMMAND_OP_GET_ENERGY:
+		{
+			struct energy_status_t status;
+			uint8_t response[PAYLOAD_UPLINK_ENERGY_SIZE];
+
+			energy_get_status(&status);
+			(void)payload_uplink_energy_encode(response, status.uah_per_day,
+					status.active_ms[ENERGY_CONSUMER_HFCLK],
+					status.active_ms[ENERGY_CONSUMER_RADIO_TX],
+					status.active_ms[ENERGY_CONSUMER_RADIO_RX],
+					status.active_ms[ENERGY_CONSUMER_SENSOR],
+					status.active_ms[ENERGY_CONSUMER_ADC],
+					status.active_ms[ENERGY_CONSUMER_BLE_ADVERTISING],
+					status.active_ms[ENERGY_CONSUMER_LED]);
+
+			return uplink_queue_add(LORA_APP_PORT, UPLINK_QUEUE_PRIORITY_NORMAL, 0, response,
+						sizeof(response));
+		}
+#endif
+#ifdef CONFIG_APP_SUSPEND
+		case DEVICE_COMMAND_OP_SUSPEND:
+		{
+			if (data_size != PAYLOAD_DEVICE_COMMAND_OP_SUSPEND_SIZE) {
+				return -EINVAL;
+			}
+
+			app_suspend(sys_get_le32(data));
+			break;
+		}
+#endif
 		default:
 		{
 			return -EINVAL;
@@ -419,74 +987,16 @@ static int device_command(const enum device_command_op_t op, const uint8_t *data
 	return 0;
 }
 
-void lora_message_callback(uint8_t port, const uint8_t *data, uint8_t len)
+static int device_downlink(const uint8_t *data, uint8_t len)
 {
-	uint8_t response[2];
-	uint8_t response_size = 0;
-
-	if (port == 1) {
-		if (len == 0) {
-			LOG_DBG("Received 0 byte download on port 1");
-			return;
-		}
-
-		switch (data[0]) {
-#ifdef CONFIG_APP_IR_LED
-			case LORA_DOWNLINK_TYPE_IR:
-			{
-				(void)ir_led_send(data[1]);
-
-				/* Send response indicating request has been actioned */
-				response[response_size++] = LORA_UPLINK_TYPE_IR_COMPLETE;
-				error_message_lock();
-				error_message_add_error(response, response_size);
-				error_message_unlock();
-				break;
-			}
-#endif
-
-#ifdef CONFIG_APP_GARAGE_DOOR
-			case LORA_DOWNLINK_TYPE_GARAGE:
-			{
-				garage_door_open_close();
-
-				/* Send response indicating request has been actioned */
-				response[response_size++] = LORA_UPLINK_TYPE_GARAGE_COMPLETE;
-				error_message_lock();
-				error_message_add_error(response, response_size);
-				error_message_unlock();
-				break;
-			}
-#endif
-
-#ifdef CONFIG_BT
-			case LORA_DOWNLINK_TYPE_BLUETOOTH:
-			{
-				bluetooth_remote(data[1]);
-				break;
-			}
-#endif
-
-			case LORA_DOWNLINK_TYPE_DEVICE:
-			{
-				device_command(data[1], &data[2], (len - 2));
-				break;
-			}
-
-			default:
-			{
-				LOG_ERR("No handler for LoRa Downlink type %d", data[0]);
-
-				response[response_size++] = LORA_UPLINK_TYPE_ERROR_NO_HANDLER;
-				response[response_size++] = data[0];
-
-				error_message_lock();
-				error_message_add_error(response, response_size);
-				error_message_unlock();
-			}
-		};
+	if (len == 0) {
+		return -EINVAL;
 	}
+
+	return device_command(data[0], &data[1], (len - 1));
 }
+
+DOWNLINK_HANDLER_DEFINE(device_downlink_handler, LORA_DOWNLINK_TYPE_DEVICE, device_downlink);
 #endif
 
 void k_sys_fatal_error_handler(unsigned int reason, const struct arch_esf *esf)
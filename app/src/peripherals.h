@@ -7,7 +7,14 @@
 #ifndef APP_PERIPHERALS_H
 #define APP_PERIPHERALS_H
 
+#ifdef CONFIG_SOC_SERIES_NRF51X
 /* Sets peripherals up (by disabling them) */
 void peripheral_setup(void);
+#else
+/* Nothing to set up on other SoCs (e.g. native_sim) */
+static inline void peripheral_setup(void)
+{
+}
+#endif
 
 #endif /* APP_PERIPHERALS_H */
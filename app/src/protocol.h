@@ -0,0 +1,13 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_PROTOCOL_H
+#define APP_PROTOCOL_H
+
+/* Uplink/downlink types, sizes and encoders are generated from schema/payloads.yaml */
+#include "app_payloads.h"
+
+#endif /* APP_PROTOCOL_H */
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include "readings.h"
+#include "lora.h"
+
+#ifdef CONFIG_APP_READINGS_COMPACT
+#include "readings_codec.h"
+#endif
+
+#ifdef CONFIG_APP_READINGS_BACKLOG
+#include "backlog.h"
+#endif
+
+LOG_MODULE_REGISTER(readings, CONFIG_APP_READINGS_LOG_LEVEL);
+
+#define MAX_LATENCY_MS (CONFIG_APP_READINGS_BATCH_MAX_LATENCY * MSEC_PER_SEC)
+
+static struct reading_t readings[CONFIG_APP_READINGS_BATCH_COUNT];
+static uint8_t readings_head = 0;
+static uint8_t readings_count = 0;
+static int64_t oldest_reading_time = 0;
+
+#ifdef CONFIG_APP_READINGS_BACKLOG
+/* Uptime (in seconds) each reading was taken, for readings moved to the backlog */
+static uint32_t reading_times[CONFIG_APP_READINGS_BATCH_COUNT];
+#endif
+
+void readings_add(const int8_t *temperature, const int8_t *humidity, uint16_t voltage,
+		  uint16_t interval)
+{
+	uint8_t index = (readings_head + readings_count) % CONFIG_APP_READINGS_BATCH_COUNT;
+
+	if (readings_count == CONFIG_APP_READINGS_BATCH_COUNT) {
+#ifdef CONFIG_APP_READINGS_BACKLOG
+		/* Buffer full, move oldest reading to backlog */
+		backlog_add(&readings[readings_head], reading_times[readings_head], interval);
+#else
+		/* Buffer full, drop oldest reading */
+		LOG_WRN("Readings buffer full, dropping oldest reading");
+#endif
+		readings_head = (readings_head + 1) % CONFIG_APP_READINGS_BATCH_COUNT;
+	} else {
+		if (readings_count == 0) {
+			oldest_reading_time = k_uptime_get();
+		}
+
+		++readings_count;
+	}
+
+	readings[index].temperature[0] = temperature[0];
+	readings[index].temperature[1] = temperature[1];
+	readings[index].humidity[0] = humidity[0];
+	readings[index].humidity[1] = humidity[1];
+	readings[index].voltage = voltage;
+
+#ifdef CONFIG_APP_READINGS_BACKLOG
+	reading_times[index] = (uint32_t)(k_uptime_get() / MSEC_PER_SEC);
+#endif
+}
+
+uint8_t readings_get_count(void)
+{
+	return readings_count;
+}
+
+int readings_get(uint8_t index, struct reading_t *reading)
+{
+	if (index >= readings_count) {
+		return -ENOENT;
+	}
+
+	memcpy(reading, &readings[(readings_head + index) % CONFIG_APP_READINGS_BATCH_COUNT],
+	       sizeof(*reading));
+
+	return 0;
+}
+
+#ifdef CONFIG_APP_READINGS_BACKLOG
+uint32_t readings_get_time(uint8_t index)
+{
+	return reading_times[(readings_head + index) % CONFIG_APP_READINGS_BATCH_COUNT];
+}
+#endif
+
+#ifdef CONFIG_APP_READINGS_COMPACT
+static uint16_t readings_compact_size(void)
+{
+	struct readings_codec_t codec;
+	uint16_t size = READINGS_HEADER_SIZE;
+	uint8_t i = 0;
+
+	readings_codec_reset(&codec);
+
+	while (i < readings_count) {
+		size += readings_codec_encode(&codec, &readings[(readings_head + i) %
+							       CONFIG_APP_READINGS_BATCH_COUNT],
+					      NULL, UINT8_MAX);
+		++i;
+	}
+
+	return size;
+}
+#endif
+
+bool readings_flush_required(void)
+{
+	uint8_t max_size;
+
+	if (readings_count == 0) {
+		return false;
+	} else if (readings_count == CONFIG_APP_READINGS_BATCH_COUNT) {
+		return true;
+	} else if ((k_uptime_get() - oldest_reading_time) >= MAX_LATENCY_MS) {
+		return true;
+	}
+
+	/* Send if another reading would not fit in the maximum payload of the current datarate */
+	max_size = lora_get_max_payload_size();
+
+#ifdef CONFIG_APP_READINGS_COMPACT
+	return (readings_compact_size() + READINGS_CODEC_DELTA_MAX_SIZE) > max_size;
+#else
+	return (READINGS_HEADER_SIZE + (readings_count + 1) * READINGS_ENTRY_SIZE) > max_size;
+#endif
+}
+
+uint8_t readings_encode(uint8_t type, uint16_t interval, uint8_t *data, uint8_t max_size,
+			uint8_t *count)
+{
+	uint8_t data_size = 0;
+	uint8_t i = 0;
+
+	if (max_size < (READINGS_HEADER_SIZE + READINGS_ENTRY_SIZE)) {
+		*count = 0;
+		return 0;
+	}
+
+	data[data_size++] = type;
+	sys_put_be16(interval, &data[data_size]);
+	data_size += sizeof(interval);
+
+	/* Placeholder for count */
+	++data_size;
+
+#ifdef CONFIG_APP_READINGS_COMPACT
+	struct readings_codec_t codec;
+
+	readings_codec_reset(&codec);
+
+	while (i < readings_count) {
+		uint8_t entry_size = readings_codec_encode(&codec, &readings[(readings_head + i) %
+									    CONFIG_APP_READINGS_BATCH_COUNT],
+							   &data[data_size], (max_size - data_size));
+
+		if (entry_size == 0) {
+			break;
+		}
+
+		data_size += entry_size;
+		++i;
+	}
+#else
+	while (i < readings_count && (data_size + READINGS_ENTRY_SIZE) <= max_size) {
+		const struct reading_t *reading =
+			&readings[(readings_head + i) % CONFIG_APP_READINGS_BATCH_COUNT];
+
+		readings_put_entry(reading, &data[data_size]);
+		data_size += READINGS_ENTRY_SIZE;
+		++i;
+	}
+#endif
+
+	*count = i;
+
+	if (i == 0) {
+		/* No readings fit, nothing to send */
+		return 0;
+	}
+
+	data[READINGS_HEADER_SIZE - 1] = i;
+
+	return data_size;
+}
+
+void readings_remove(uint8_t count)
+{
+	if (count >= readings_count) {
+		readings_head = 0;
+		readings_count = 0;
+		return;
+	}
+
+	readings_head = (readings_head + count) % CONFIG_APP_READINGS_BATCH_COUNT;
+	readings_count -= count;
+
+	/* Age of remaining readings is not tracked individually, restart latency period */
+	oldest_reading_time = k_uptime_get();
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_READINGS_H
+#define APP_READINGS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Size of a single reading in a batch uplink */
+#define READINGS_ENTRY_SIZE 6
+
+/* Size of the header of a batch uplink: type, sample interval (2 bytes) and count */
+#define READINGS_HEADER_SIZE 4
+
+struct reading_t {
+	int8_t temperature[2];
+	int8_t humidity[2];
+	uint16_t voltage;
+};
+
+/* Encode a single reading entry into data (which must have READINGS_ENTRY_SIZE bytes free) */
+static inline void readings_put_entry(const struct reading_t *reading, uint8_t *data)
+{
+	data[0] = reading->temperature[0];
+	data[1] = reading->temperature[1];
+	data[2] = reading->humidity[0];
+	data[3] = reading->humidity[1];
+	data[4] = (reading->voltage >> 8) & 0xff;
+	data[5] = reading->voltage & 0xff;
+}
+
+/* Add a reading to the buffer taken with the current reading interval (in seconds), the oldest
+ * reading is moved to the backlog (or overwritten without the backlog) if the buffer is full
+ */
+void readings_add(const int8_t *temperature, const int8_t *humidity, uint16_t voltage,
+		  uint16_t interval);
+
+/* Get number of buffered readings */
+uint8_t readings_get_count(void);
+
+/* Get a buffered reading, index 0 is the oldest */
+int readings_get(uint8_t index, struct reading_t *reading);
+
+/* Get the uptime (in seconds) a buffered reading was taken, only available with the backlog */
+uint32_t readings_get_time(uint8_t index);
+
+/* Check if buffered readings should be sent (payload is full or maximum latency reached) */
+bool readings_flush_required(void);
+
+/* Encode buffered readings (oldest first) into a batch uplink, returns the size of the uplink
+ * (0 if no readings could be encoded) and outputs the number of readings that were encoded
+ */
+uint8_t readings_encode(uint8_t type, uint16_t interval, uint8_t *data, uint8_t max_size,
+			uint8_t *count);
+
+/* Remove the oldest number of readings from the buffer (after they have been sent) */
+void readings_remove(uint8_t count);
+
+#endif /* APP_READINGS_H */
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include "readings_codec.h"
+
+/* Varints use 7 bits per byte, deltas of 16-bit values need at most 17 bits after zig-zag */
+#define VARINT_MAX_SIZE 3
+#define VARINT_CONTINUE 0x80
+#define VARINT_MASK 0x7f
+#define DELTA_FIELDS 3
+
+static uint32_t zigzag_encode(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t zigzag_decode(uint32_t value)
+{
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 0x1);
+}
+
+static uint8_t varint_size(uint32_t value)
+{
+	uint8_t size = 1;
+
+	while (value > VARINT_MASK) {
+		value >>= 7;
+		++size;
+	}
+
+	return size;
+}
+
+static uint8_t varint_encode(uint32_t value, uint8_t *data)
+{
+	uint8_t size = 0;
+
+	while (value > VARINT_MASK) {
+		data[size++] = (value & VARINT_MASK) | VARINT_CONTINUE;
+		value >>= 7;
+	}
+
+	data[size++] = value;
+
+	return size;
+}
+
+static int varint_decode(const uint8_t *data, uint8_t size, uint32_t *value)
+{
+	uint8_t pos = 0;
+
+	*value = 0;
+
+	while (pos < size && pos < VARINT_MAX_SIZE) {
+		*value |= (uint32_t)(data[pos] & VARINT_MASK) << (pos * 7);
+
+		if ((data[pos++] & VARINT_CONTINUE) == 0) {
+			return pos;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static int16_t to_fixed(const int8_t *value)
+{
+	return (int16_t)value[0] * 100 + value[1];
+}
+
+static void from_fixed(int16_t fixed, int8_t *value)
+{
+	value[0] = fixed / 100;
+	value[1] = fixed % 100;
+}
+
+void readings_codec_reset(struct readings_codec_t *codec)
+{
+	codec->keyframe = true;
+	codec->temperature = 0;
+	codec->humidity = 0;
+	codec->voltage = 0;
+}
+
+uint8_t readings_codec_encode(struct readings_codec_t *codec, const struct reading_t *reading,
+			      uint8_t *data, uint8_t max_size)
+{
+	int16_t temperature = to_fixed(reading->temperature);
+	int16_t humidity = to_fixed(reading->humidity);
+	uint8_t size;
+
+	if (codec->keyframe == true) {
+		if (max_size < READINGS_CODEC_KEYFRAME_SIZE) {
+			return 0;
+		}
+
+		if (data != NULL) {
+			data[0] = ((uint16_t)temperature >> 8) & 0xff;
+			data[1] = (uint16_t)temperature & 0xff;
+			data[2] = ((uint16_t)humidity >> 8) & 0xff;
+			data[3] = (uint16_t)humidity & 0xff;
+			data[4] = (reading->voltage >> 8) & 0xff;
+			data[5] = reading->voltage & 0xff;
+		}
+
+		size = READINGS_CODEC_KEYFRAME_SIZE;
+		codec->keyframe = false;
+	} else {
+		uint32_t delta_temperature = zigzag_encode((int32_t)temperature - codec->temperature);
+		uint32_t delta_humidity = zigzag_encode((int32_t)humidity - codec->humidity);
+		uint32_t delta_voltage = zigzag_encode((int32_t)reading->voltage - codec->voltage);
+
+		size = varint_size(delta_temperature) + varint_size(delta_humidity) +
+		       varint_size(delta_voltage);
+
+		if (size > max_size) {
+			return 0;
+		}
+
+		if (data != NULL) {
+			uint8_t pos = varint_encode(delta_temperature, data);
+
+			pos += varint_encode(delta_humidity, &data[pos]);
+			(void)varint_encode(delta_voltage, &data[pos]);
+		}
+	}
+
+	codec->temperature = temperature;
+	codec->humidity = humidity;
+	codec->voltage = reading->voltage;
+
+	return size;
+}
+
+int readings_codec_decode(struct readings_codec_t *codec, const uint8_t *data, uint8_t size,
+			  struct reading_t *reading)
+{
+	int pos = 0;
+
+	if (codec->keyframe == true) {
+		if (size < READINGS_CODEC_KEYFRAME_SIZE) {
+			return -EINVAL;
+		}
+
+		codec->temperature = (int16_t)(((uint16_t)data[0] << 8) | data[1]);
+		codec->humidity = (int16_t)(((uint16_t)data[2] << 8) | data[3]);
+		codec->voltage = ((uint16_t)data[4] << 8) | data[5];
+		codec->keyframe = false;
+		pos = READINGS_CODEC_KEYFRAME_SIZE;
+	} else {
+		uint32_t deltas[DELTA_FIELDS];
+		uint8_t i = 0;
+
+		while (i < DELTA_FIELDS) {
+			int rc = varint_decode(&data[pos], (size - pos), &deltas[i]);
+
+			if (rc < 0) {
+				return rc;
+			}
+
+			pos += rc;
+			++i;
+		}
+
+		codec->temperature += zigzag_decode(deltas[0]);
+		codec->humidity += zigzag_decode(deltas[1]);
+		codec->voltage += zigzag_decode(deltas[2]);
+	}
+
+	from_fixed(codec->temperature, reading->temperature);
+	from_fixed(codec->humidity, reading->humidity);
+	reading->voltage = codec->voltage;
+
+	return pos;
+}
+
+int readings_codec_decode_uplink(const uint8_t *data, uint8_t size, uint8_t type,
+				 uint16_t *interval, struct reading_t *readings, uint8_t max_count)
+{
+	struct readings_codec_t codec;
+	uint8_t pos = READINGS_HEADER_SIZE;
+	uint8_t count;
+	uint8_t i = 0;
+
+	if (size < READINGS_HEADER_SIZE) {
+		return -EINVAL;
+	} else if (data[0] != type) {
+		return -ENOTSUP;
+	}
+
+	*interval = ((uint16_t)data[1] << 8) | data[2];
+	count = data[3];
+
+	if (count > max_count) {
+		return -ENOMEM;
+	}
+
+	readings_codec_reset(&codec);
+
+	while (i < count) {
+		int rc = readings_codec_decode(&codec, &data[pos], (size - pos), &readings[i]);
+
+		if (rc < 0) {
+			return rc;
+		}
+
+		pos += rc;
+		++i;
+	}
+
+	return count;
+}
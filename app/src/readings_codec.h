@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_READINGS_CODEC_H
+#define APP_READINGS_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "readings.h"
+
+/* Size of the absolute (first) reading in a compact uplink */
+#define READINGS_CODEC_KEYFRAME_SIZE 6
+
+/* Largest possible size of a delta encoded reading (3 varints of up to 3 bytes) */
+#define READINGS_CODEC_DELTA_MAX_SIZE 9
+
+/*
+ * Compact readings encoding: the first reading is sent as an absolute keyframe of temperature
+ * and humidity (in 0.01 units, signed big endian) and voltage (mV, big endian), each following
+ * reading is sent as the zig-zag varint encoded difference of temperature, humidity and voltage
+ * from the previous reading.
+ */
+struct readings_codec_t {
+	bool keyframe;
+	int16_t temperature;
+	int16_t humidity;
+	uint16_t voltage;
+};
+
+/* Reset codec state, next reading will be a keyframe */
+void readings_codec_reset(struct readings_codec_t *codec);
+
+/* Encode a reading, returns the number of bytes used or 0 if it does not fit in max_size. If
+ * data is NULL, only the size is calculated and the codec state is still updated
+ */
+uint8_t readings_codec_encode(struct readings_codec_t *codec, const struct reading_t *reading,
+			      uint8_t *data, uint8_t max_size);
+
+/* Decode a reading, returns the number of bytes used or a negative error code */
+int readings_codec_decode(struct readings_codec_t *codec, const uint8_t *data, uint8_t size,
+			  struct reading_t *reading);
+
+/* Decode a compact readings uplink (header and readings) which must be of the given type,
+ * returns the number of readings decoded or a negative error code: -EINVAL if the uplink or a
+ * reading is truncated, -ENOTSUP if the type does not match and -ENOMEM if there are more than
+ * max_count readings
+ */
+int readings_codec_decode_uplink(const uint8_t *data, uint8_t size, uint8_t type,
+				 uint16_t *interval, struct reading_t *readings, uint8_t max_count);
+
+#endif /* APP_READINGS_CODEC_H */
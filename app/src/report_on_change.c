@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <stdlib.h>
+#include "report_on_change.h"
+#include "settings.h"
+
+LOG_MODULE_REGISTER(report_on_change, CONFIG_APP_REPORT_ON_CHANGE_LOG_LEVEL);
+
+BUILD_ASSERT(sizeof(struct report_on_change_settings_t) == REPORT_ON_CHANGE_SIZE,
+	     "Invalid report on change settings size");
+
+static bool reported = false;
+static int16_t last_temperature;
+static int16_t last_humidity;
+static uint16_t last_voltage;
+static uint16_t skipped_readings = 0;
+
+static int16_t to_fixed(const int8_t *value)
+{
+	return (int16_t)value[0] * 100 + value[1];
+}
+
+static void report_on_change_get_settings(struct report_on_change_settings_t *deadbands)
+{
+	app_keys_get_report_on_change((uint8_t *)deadbands);
+
+	if (deadbands->heartbeat == 0) {
+		/* Not set, use defaults */
+		deadbands->temperature = CONFIG_APP_REPORT_ON_CHANGE_TEMPERATURE;
+		deadbands->humidity = CONFIG_APP_REPORT_ON_CHANGE_HUMIDITY;
+		deadbands->voltage = CONFIG_APP_REPORT_ON_CHANGE_VOLTAGE;
+		deadbands->heartbeat = CONFIG_APP_REPORT_ON_CHANGE_HEARTBEAT;
+	}
+}
+
+bool report_on_change_required(const int8_t *temperature, const int8_t *humidity,
+			       uint16_t voltage)
+{
+	struct report_on_change_settings_t deadbands;
+
+	if (reported == false) {
+		/* Nothing has been sent yet */
+		return true;
+	}
+
+	report_on_change_get_settings(&deadbands);
+
+	if (abs(to_fixed(temperature) - last_temperature) >= deadbands.temperature ||
+	    abs(to_fixed(humidity) - last_humidity) >= deadbands.humidity ||
+	    abs((int32_t)voltage - last_voltage) >= deadbands.voltage) {
+		return true;
+	}
+
+	++skipped_readings;
+
+	if (skipped_readings >= deadbands.heartbeat) {
+		LOG_DBG("Heartbeat reading required");
+		return true;
+	}
+
+	LOG_DBG("Reading unchanged, skipped %d", skipped_readings);
+
+	return false;
+}
+
+void report_on_change_sent(const int8_t *temperature, const int8_t *humidity, uint16_t voltage)
+{
+	reported = true;
+	skipped_readings = 0;
+	last_temperature = to_fixed(temperature);
+	last_humidity = to_fixed(humidity);
+	last_voltage = voltage;
+}
+
+int report_on_change_set(const uint8_t *data, uint8_t data_size)
+{
+	struct report_on_change_settings_t deadbands;
+
+	if (data_size != sizeof(deadbands)) {
+		return -EINVAL;
+	}
+
+	memcpy(&deadbands, data, sizeof(deadbands));
+
+	if (deadbands.heartbeat == 0) {
+		return -EINVAL;
+	}
+
+	return setting_set(SETTING_ID_REPORT_ON_CHANGE, &deadbands, sizeof(deadbands));
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_REPORT_ON_CHANGE_H
+#define APP_REPORT_ON_CHANGE_H
+
+#include <zephyr/kernel.h>
+
+/* Deadbands, stored in settings and received from LoRa as little endian values, a heartbeat of 0
+ * indicates that the defaults should be used
+ */
+struct report_on_change_settings_t {
+	/* Temperature deadband, in 0.01C */
+	uint16_t temperature;
+	/* Humidity deadband, in 0.01% */
+	uint16_t humidity;
+	/* Voltage deadband, in mV */
+	uint16_t voltage;
+	/* Number of readings without an uplink before a reading is always sent */
+	uint16_t heartbeat;
+} __packed;
+
+/* Check if a reading has changed enough (or heartbeat period reached) that it should be sent */
+bool report_on_change_required(const int8_t *temperature, const int8_t *humidity,
+			       uint16_t voltage);
+
+/* Mark reading as sent, resets the heartbeat period and sets the values changes are checked
+ * against
+ */
+void report_on_change_sent(const int8_t *temperature, const int8_t *humidity, uint16_t voltage);
+
+/* Set deadbands (from LoRa) */
+int report_on_change_set(const uint8_t *data, uint8_t data_size);
+
+#endif /* APP_REPORT_ON_CHANGE_H */
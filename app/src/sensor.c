@@ -9,6 +9,7 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/drivers/sensor.h>
 #include <zephyr/drivers/regulator.h>
+#include "energy.h"
 
 LOG_MODULE_REGISTER(sensor, CONFIG_APP_SENSOR_LOG_LEVEL);
 
@@ -16,6 +17,8 @@ LOG_MODULE_REGISTER(sensor, CONFIG_APP_SENSOR_LOG_LEVEL);
 #define SENSOR_DEV DT_NODELABEL(si7021)
 #elif CONFIG_DT_HAS_BOSCH_BME680_ENABLED
 #define SENSOR_DEV DT_NODELABEL(bme680)
+#elif CONFIG_DT_HAS_LORA_HACKS_SIM_SENSOR_ENABLED
+#define SENSOR_DEV DT_NODELABEL(sim_sensor)
 #else
 #error "No sensor selected"
 #endif
@@ -44,7 +47,9 @@ int sensor_fetch_readings(int8_t *temperature, int8_t *humidity)
 	}
 #endif
 
+	energy_start(ENERGY_CONSUMER_SENSOR);
 	rc = sensor_sample_fetch(sensor);
+	energy_stop(ENERGY_CONSUMER_SENSOR);
 
 	if (rc) {
 		LOG_ERR("Sensor fetch failed: %d", rc);
@@ -5,20 +5,70 @@
  */
 
 #include <zephyr/kernel.h>
+#include <zephyr/sys/math_extras.h>
 #include <zephyr/settings/settings.h>
 #include <zephyr/logging/log.h>
 #include "settings.h"
+#include "flash_maintenance.h"
+
+#ifdef CONFIG_APP_LORA_ALLOW_DOWNLINKS
+#include "downlink.h"
+#include "protocol.h"
+#include "lora.h"
+#include "uplink_queue.h"
+#endif
 
 LOG_MODULE_REGISTER(app_settings, CONFIG_APP_SETTINGS_LOG_LEVEL);
 
-#define MAX_SETTING_KEY_LENGTH 24
+#ifdef CONFIG_BT
+#define MAX_SETTING_VALUE_LENGTH MAX(LORA_APP_KEY_SIZE, BLUETOOTH_DEVICE_NAME_SIZE)
+#else
+#define MAX_SETTING_VALUE_LENGTH LORA_APP_KEY_SIZE
+#endif
+
+enum setting_subtree_t {
+	SETTING_SUBTREE_LORA_KEYS,
+	SETTING_SUBTREE_APP,
+};
+
+struct setting_t {
+	/* Full key, including the subtree */
+	const char *key;
+	/* RAM copy of the value, used for all reads */
+	uint8_t *value;
+	/* Offset of the name (without the subtree) in the key */
+	uint8_t name_offset;
+	uint8_t size;
+	uint8_t subtree;
+	uint8_t validate;
+};
+
+#define SETTING(_subtree, _prefix, _name, _value, _validate)					\
+	{											\
+		.key = _prefix "/" _name,							\
+		.value = _value,								\
+		.name_offset = sizeof(_prefix),							\
+		.size = sizeof(_value),								\
+		.subtree = _subtree,								\
+		.validate = _validate,								\
+	}
+
+#define LORA_KEYS_SETTING(_name, _value)							\
+	SETTING(SETTING_SUBTREE_LORA_KEYS, "lora_keys", _name, _value, SETTING_VALIDATE_EXACT)
+
+#define APP_SETTING(_name, _value, _validate)							\
+	SETTING(SETTING_SUBTREE_APP, "app", _name, _value, _validate)
 
 static uint8_t lora_dev_eui[LORA_DEV_EUI_SIZE];
 static uint8_t lora_join_eui[LORA_JOIN_EUI_SIZE];
 static uint8_t lora_app_key[LORA_APP_KEY_SIZE];
 
 #ifdef CONFIG_APP_EXTERNAL_DCDC
-static uint16_t power_offset_mv;
+static uint8_t power_offset_mv[POWER_OFFSET_MV_SIZE];
+#endif
+
+#ifdef CONFIG_APP_REPORT_ON_CHANGE
+static uint8_t report_on_change[REPORT_ON_CHANGE_SIZE];
 #endif
 
 #ifdef CONFIG_BT
@@ -29,270 +79,498 @@ static uint8_t bluetooth_fixed_passkey[BLUETOOTH_FIXED_PASSKEY_SIZE];
 #endif
 #endif
 
-#if defined(CONFIG_APP_EXTERNAL_DCDC) || defined(CONFIG_BT)
-#define HAS_APP_SETTINGS 1
+static const struct setting_t setting_table[SETTING_ID_COUNT] = {
+	[SETTING_ID_LORA_DEV_EUI] = LORA_KEYS_SETTING("dev_eui", lora_dev_eui),
+	[SETTING_ID_LORA_JOIN_EUI] = LORA_KEYS_SETTING("join_eui", lora_join_eui),
+	[SETTING_ID_LORA_APP_KEY] = LORA_KEYS_SETTING("app_key", lora_app_key),
+#ifdef CONFIG_APP_EXTERNAL_DCDC
+	[SETTING_ID_POWER_OFFSET] = APP_SETTING("power_offset", power_offset_mv,
+						SETTING_VALIDATE_EXACT),
+#endif
+#ifdef CONFIG_APP_REPORT_ON_CHANGE
+	[SETTING_ID_REPORT_ON_CHANGE] = APP_SETTING("report_on_change", report_on_change,
+						    SETTING_VALIDATE_EXACT),
 #endif
+#ifdef CONFIG_BT
+	[SETTING_ID_BLUETOOTH_NAME] = APP_SETTING("bluetooth_name", bluetooth_device_name,
+						  SETTING_VALIDATE_STRING),
+#ifdef CONFIG_BT_FIXED_PASSKEY
+	[SETTING_ID_BLUETOOTH_FIXED_PASSKEY] = APP_SETTING("bluetooth_fixed_passkey",
+							   bluetooth_fixed_passkey,
+							   SETTING_VALIDATE_EXACT),
+#endif
+#endif
+};
 
-static int lora_keys_handle_set(const char *name, size_t len, settings_read_cb read_cb,
-				void *cb_arg)
+BUILD_ASSERT(SETTING_ID_COUNT <= 32, "Too many settings for dirty mask");
+
+/* Settings are cached in RAM when loaded or set, so that they can be read without a lookup,
+ * changed settings are marked as dirty and written to storage together when committed
+ */
+static struct k_spinlock cache_lock;
+static uint32_t dirty;
+static uint8_t transactions;
+static bool loading;
+static K_MUTEX_DEFINE(commit_lock);
+
+static void transaction_timeout_handler(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(transaction_timeout_work, transaction_timeout_handler);
+
+static int setting_lookup(enum setting_subtree_t subtree, const char *name)
 {
 	const char *next;
-	size_t name_len;
-	int rc = -ENOENT;
-	uint8_t *output = NULL;
-	uint8_t output_size = 0;
-
-	name_len = settings_name_next(name, &next);
-
-	if (!next) {
-		if (strncmp(name, "dev_eui", name_len) == 0) {
-			output = lora_dev_eui;
-			output_size = sizeof(lora_dev_eui);
-		} else if (strncmp(name, "join_eui", name_len) == 0) {
-			output = lora_join_eui;
-			output_size = sizeof(lora_join_eui);
-		} else if (strncmp(name, "app_key", name_len) == 0) {
-			output = lora_app_key;
-			output_size = sizeof(lora_app_key);
+	uint8_t i = 0;
+
+	while (i < SETTING_ID_COUNT) {
+		const struct setting_t *setting = &setting_table[i];
+
+		if (setting->subtree == subtree &&
+		    settings_name_steq(name, &setting->key[setting->name_offset], &next) && !next) {
+			return i;
 		}
+
+		++i;
 	}
 
-	if (output != NULL) {
-		if (len != output_size) {
-			return -EINVAL;
-		}
+	return -ENOENT;
+}
 
-		rc = read_cb(cb_arg, output, output_size);
+/* Must be called with the lock held */
+static uint8_t setting_length(const struct setting_t *setting)
+{
+	if (setting->validate == SETTING_VALIDATE_STRING) {
+		return strnlen((const char *)setting->value, setting->size);
+	}
 
-		if (rc < 0) {
-			goto finish;
-		}
+	return setting->size;
+}
 
-		rc = 0;
+static bool setting_valid(const struct setting_t *setting, const uint8_t *data, size_t data_size)
+{
+	if (setting->validate == SETTING_VALIDATE_STRING) {
+		return (data_size > 0 && data_size < setting->size &&
+			memchr(data, 0, data_size) == NULL);
 	}
 
-	if (rc == 0) {
-		uint8_t key_name[MAX_SETTING_KEY_LENGTH] = "lora_keys/";
+	return (data_size == setting->size);
+}
 
-		strcpy(&key_name[strlen(key_name)], name);
+/* Update the RAM copy of a (validated) setting and mark it as dirty if it has changed, values
+ * which are being loaded from storage are not marked
+ */
+static void setting_stage(enum setting_id_t id, const uint8_t *data, size_t data_size)
+{
+	const struct setting_t *setting = &setting_table[id];
+	k_spinlock_key_t key = k_spin_lock(&cache_lock);
+
+	if (setting_length(setting) != data_size || memcmp(setting->value, data, data_size) != 0) {
+		memset(setting->value, 0, setting->size);
+		memcpy(setting->value, data, data_size);
 
-		rc = settings_save_one(key_name, output, len);
+		if (!loading) {
+			dirty |= BIT(id);
+		}
 	}
 
-finish:
+	k_spin_unlock(&cache_lock, key);
+}
+
+/* Write all dirty settings to storage, settings which fail to save are left dirty */
+static int setting_commit(void)
+{
+	int rc = 0;
+	uint8_t value[MAX_SETTING_VALUE_LENGTH];
+
+	k_mutex_lock(&commit_lock, K_FOREVER);
+
+	while (1) {
+		const struct setting_t *setting;
+		k_spinlock_key_t key = k_spin_lock(&cache_lock);
+		uint8_t length;
+		uint8_t id;
+		int save_rc;
+
+		if (dirty == 0 || transactions > 0) {
+			k_spin_unlock(&cache_lock, key);
+			break;
+		}
+
+		id = u32_count_trailing_zeros(dirty);
+		setting = &setting_table[id];
+		dirty &= ~BIT(id);
+		length = setting_length(setting);
+		memcpy(value, setting->value, length);
+		k_spin_unlock(&cache_lock, key);
+
+		flash_maintenance_write_start();
+		save_rc = settings_save_one(setting->key, value, length);
+		flash_maintenance_write_end(save_rc == 0 ? length : 0);
+
+		if (save_rc != 0) {
+			LOG_ERR("Save of %s failed: %d", setting->key, save_rc);
+
+			key = k_spin_lock(&cache_lock);
+			dirty |= BIT(id);
+			k_spin_unlock(&cache_lock, key);
+			rc = save_rc;
+			break;
+		}
+	}
+
+	k_mutex_unlock(&commit_lock);
+
 	return rc;
 }
 
-static int lora_keys_handle_export(int (*cb)(const char *name, const void *value, size_t val_len))
+static int setting_handle_set(enum setting_subtree_t subtree, const char *name, size_t len,
+			      settings_read_cb read_cb, void *cb_arg)
 {
-	(void)cb("lora_keys/dev_eui", lora_dev_eui, sizeof(lora_dev_eui));
-	(void)cb("lora_keys/join_eui", lora_join_eui, sizeof(lora_join_eui));
-	(void)cb("lora_keys/app_key", lora_app_key, sizeof(lora_app_key));
+	int rc;
+	int id = setting_lookup(subtree, name);
+	uint8_t value[MAX_SETTING_VALUE_LENGTH];
+
+	if (id < 0) {
+		return id;
+	} else if (len > setting_table[id].size) {
+		return -EINVAL;
+	}
+
+	rc = read_cb(cb_arg, value, len);
+
+	if (rc < 0) {
+		return rc;
+	} else if (setting_valid(&setting_table[id], value, rc) == false) {
+		return -EINVAL;
+	}
+
+	/* Written to storage by the commit handler */
+	setting_stage(id, value, rc);
 
 	return 0;
 }
 
-static int lora_keys_handle_commit(void)
+static int setting_handle_get(enum setting_subtree_t subtree, const char *name, char *val,
+			      int val_len_max)
 {
-	return 0;
+	int id = setting_lookup(subtree, name);
+
+	if (id < 0) {
+		return id;
+	} else if (val_len_max < setting_table[id].size) {
+		return -E2BIG;
+	}
+
+	return setting_get(id, val);
 }
 
-static int lora_keys_handle_get(const char *name, char *val, int val_len_max)
+static int setting_handle_export(enum setting_subtree_t subtree,
+				 int (*cb)(const char *name, const void *value, size_t val_len))
 {
-	const char *next;
+	uint8_t i = 0;
+
+	while (i < SETTING_ID_COUNT) {
+		const struct setting_t *setting = &setting_table[i];
 
-	if (settings_name_steq(name, "dev_eui", &next) && !next) {
-		if (val_len_max < sizeof(lora_dev_eui)) {
-			return -E2BIG;
+		if (setting->subtree == subtree) {
+			(void)cb(setting->key, setting->value, setting_length(setting));
 		}
 
-		memcpy(val, lora_dev_eui, sizeof(lora_dev_eui));
-		return sizeof(lora_dev_eui);
-	} else if (settings_name_steq(name, "join_eui", &next) && !next) {
-		if (val_len_max < sizeof(lora_join_eui)) {
-			return -E2BIG;
+		++i;
+	}
+
+	return 0;
+}
+
+static void setting_clear(enum setting_subtree_t subtree)
+{
+	uint8_t i = 0;
+
+	while (i < SETTING_ID_COUNT) {
+		const struct setting_t *setting = &setting_table[i];
+
+		if (setting->subtree == subtree) {
+			k_spinlock_key_t key = k_spin_lock(&cache_lock);
+
+			memset(setting->value, 0, setting->size);
+			dirty &= ~BIT(i);
+			k_spin_unlock(&cache_lock, key);
+			flash_maintenance_write_start();
+			(void)settings_delete(setting->key);
+			flash_maintenance_write_end(0);
 		}
 
-		memcpy(val, lora_join_eui, sizeof(lora_join_eui));
-		return sizeof(lora_join_eui);
-	} else if (settings_name_steq(name, "app_key", &next) && !next) {
-		if (val_len_max < sizeof(lora_app_key)) {
-			return -E2BIG;
+		++i;
+	}
+}
+
+int setting_find(const char *name)
+{
+	uint8_t i = 0;
+
+	while (i < SETTING_ID_COUNT) {
+		if (strcmp(name, &setting_table[i].key[setting_table[i].name_offset]) == 0) {
+			return i;
 		}
 
-		memcpy(val, lora_app_key, sizeof(lora_app_key));
-		return sizeof(lora_app_key);
+		++i;
 	}
 
 	return -ENOENT;
 }
 
-void lora_keys_load(void)
+const char *setting_name(enum setting_id_t id)
 {
-	settings_subsys_init();
-	settings_load_subtree("lora_keys");
+	if (id >= SETTING_ID_COUNT) {
+		return NULL;
+	}
+
+	return &setting_table[id].key[setting_table[id].name_offset];
 }
 
-void lora_keys_clear(void)
+uint8_t setting_size(enum setting_id_t id)
 {
-	(void)settings_delete("lora_keys");
+	if (id >= SETTING_ID_COUNT) {
+		return 0;
+	}
+
+	return setting_table[id].size;
 }
 
-SETTINGS_STATIC_HANDLER_DEFINE(lora_keys, "lora_keys", lora_keys_handle_get, lora_keys_handle_set,
-			       lora_keys_handle_commit, lora_keys_handle_export);
+int setting_get(enum setting_id_t id, void *data)
+{
+	k_spinlock_key_t key;
+	uint8_t length;
 
+	if (id >= SETTING_ID_COUNT) {
+		return -ENOENT;
+	}
 
-/* Application settings */
+	key = k_spin_lock(&cache_lock);
+	memcpy(data, setting_table[id].value, setting_table[id].size);
+	length = setting_length(&setting_table[id]);
+	k_spin_unlock(&cache_lock, key);
 
-#if defined(HAS_APP_SETTINGS)
-static int app_handle_set(const char *name, size_t len, settings_read_cb read_cb,
-				void *cb_arg)
+	return length;
+}
+
+int setting_set(enum setting_id_t id, const void *data, uint8_t data_size)
 {
-	const char *next;
-	size_t name_len;
-	int rc = -ENOENT;
-	uint8_t *output = NULL;
-	uint8_t output_size = 0;
+	if (id >= SETTING_ID_COUNT) {
+		return -ENOENT;
+	} else if (setting_valid(&setting_table[id], data, data_size) == false) {
+		return -EINVAL;
+	}
 
-	name_len = settings_name_next(name, &next);
+	setting_stage(id, data, data_size);
 
-	if (!next) {
-#ifdef CONFIG_APP_EXTERNAL_DCDC
-		if (strncmp(name, "power_offset", name_len) == 0) {
-			output = (uint8_t *)&power_offset_mv;
-			output_size = sizeof(power_offset_mv);
-		}
-#endif
+	return setting_commit();
+}
 
-#ifdef CONFIG_BT
-		if (strncmp(name, "bluetooth_name", name_len) == 0) {
-			if (len == 0 || len >= sizeof(bluetooth_device_name) || ((uint8_t *)cb_arg)[len] == 0) {
-				return -EINVAL;
-			}
-
-			output = bluetooth_device_name;
-			output_size = sizeof(bluetooth_device_name);
-			memset(bluetooth_device_name, 0, sizeof(bluetooth_device_name));
-			goto save;
-		}
+static void transaction_timeout_handler(struct k_work *work)
+{
+	k_spinlock_key_t key = k_spin_lock(&cache_lock);
+	uint8_t open = transactions;
 
-#ifdef CONFIG_BT_FIXED_PASSKEY
-		if (strncmp(name, "bluetooth_fixed_passkey", name_len) == 0) {
-			output = bluetooth_fixed_passkey;
-			output_size = sizeof(bluetooth_fixed_passkey);
-		}
-#endif
-#endif
-	}
+	transactions = 0;
+	k_spin_unlock(&cache_lock, key);
 
-	if (output != NULL) {
-		if (len != output_size) {
-			return -EINVAL;
-		}
+	if (open > 0) {
+		LOG_WRN("Settings transaction not committed, committing");
+		(void)setting_commit();
+	}
+}
 
-#ifdef CONFIG_BT
-save:
-#endif
-		rc = read_cb(cb_arg, output, output_size);
+void setting_transaction_begin(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&cache_lock);
 
-		if (rc < 0) {
-			goto finish;
-		}
+	++transactions;
+	k_spin_unlock(&cache_lock, key);
 
-		rc = 0;
-	}
+	/* Restarted by nested transactions, the timeout applies to the most recent begin */
+	(void)k_work_reschedule(&transaction_timeout_work,
+				K_SECONDS(CONFIG_APP_SETTINGS_TRANSACTION_TIMEOUT));
+}
 
-	if (rc == 0) {
-		uint8_t key_name[MAX_SETTING_KEY_LENGTH] = "app/";
+int setting_transaction_commit(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&cache_lock);
 
-		strcpy(&key_name[strlen(key_name)], name);
+	if (transactions > 0) {
+		--transactions;
+	}
 
-		rc = settings_save_one(key_name, output, len);
+	if (transactions == 0) {
+		(void)k_work_cancel_delayable(&transaction_timeout_work);
 	}
 
-finish:
-	return rc;
+	k_spin_unlock(&cache_lock, key);
+
+	return setting_commit();
 }
 
-static int app_handle_export(int (*cb)(const char *name, const void *value, size_t val_len))
+static int setting_lora_id(enum lora_setting_index index)
 {
+	switch (index) {
 #ifdef CONFIG_APP_EXTERNAL_DCDC
-	(void)cb("app/power_offset", &power_offset_mv, sizeof(power_offset_mv));
+	case LORA_SETTING_INDEX_ADC_OFFSET:
+		return SETTING_ID_POWER_OFFSET;
 #endif
-
 #ifdef CONFIG_BT
-	(void)cb("app/bluetooth_name", bluetooth_device_name, strlen(bluetooth_device_name));
+	case LORA_SETTING_INDEX_BLUETOOTH_DEVICE_NAME:
+		return SETTING_ID_BLUETOOTH_NAME;
 #ifdef CONFIG_BT_FIXED_PASSKEY
-	(void)cb("app/bluetooth_fixed_passkey", bluetooth_fixed_passkey, sizeof(bluetooth_fixed_passkey));
+	case LORA_SETTING_INDEX_BLUETOOTH_FIXED_PASSKEY:
+		return SETTING_ID_BLUETOOTH_FIXED_PASSKEY;
 #endif
 #endif
-
-	return 0;
+#ifdef CONFIG_APP_REPORT_ON_CHANGE
+	case LORA_SETTING_INDEX_REPORT_ON_CHANGE:
+		return SETTING_ID_REPORT_ON_CHANGE;
+#endif
+	default:
+		return -ENOENT;
+	}
 }
 
-static int app_handle_commit(void)
+int setting_lora(enum lora_setting_index index, const uint8_t *data, uint8_t data_size,
+		 uint8_t *value)
 {
-	return 0;
-}
+	int id = setting_lora_id(index);
 
-static int app_handle_get(const char *name, char *val, int val_len_max)
-{
-	const char *next;
+	if (id < 0) {
+		return id;
+	}
 
-#ifdef CONFIG_APP_EXTERNAL_DCDC
-	if (settings_name_steq(name, "power_offset", &next) && !next) {
-		if (val_len_max < sizeof(power_offset_mv)) {
-			return -E2BIG;
+	if (data_size > 0) {
+		int rc = setting_set(id, data, data_size);
+
+		if (rc != 0) {
+			return rc;
 		}
+	}
 
-		memcpy(val, &power_offset_mv, sizeof(power_offset_mv));
-		return sizeof(power_offset_mv);
+#if defined(CONFIG_BT) && defined(CONFIG_BT_FIXED_PASSKEY)
+	if (id == SETTING_ID_BLUETOOTH_FIXED_PASSKEY) {
+		/* Passkey can be set but not read back */
+		return 0;
 	}
 #endif
 
-#ifdef CONFIG_BT
-	if (settings_name_steq(name, "bluetooth_name", &next) && !next) {
-		if (val_len_max < strlen(bluetooth_device_name)) {
-			return -E2BIG;
-		}
+	return setting_get(id, value);
+}
+
+#ifdef CONFIG_APP_LORA_ALLOW_DOWNLINKS
+/* Setting downlink: LoRa setting index followed by the new value (if setting), answered with a
+ * setting uplink containing the result and current value
+ */
+static int setting_downlink(const uint8_t *data, uint8_t len)
+{
+	uint8_t response[PAYLOAD_UPLINK_SETTING_SIZE + MAX_SETTING_VALUE_LENGTH];
+	int rc;
 
-		memcpy(val, bluetooth_device_name, strlen(bluetooth_device_name));
-		return strlen(bluetooth_device_name);
+	if (len < PAYLOAD_DOWNLINK_SETTING_SIZE) {
+		return -EINVAL;
 	}
 
-#ifdef CONFIG_BT_FIXED_PASSKEY
-	if (settings_name_steq(name, "bluetooth_fixed_passkey", &next) && !next) {
-		if (val_len_max < sizeof(bluetooth_fixed_passkey)) {
-			return -E2BIG;
-		}
+	rc = setting_lora(data[0], &data[PAYLOAD_DOWNLINK_SETTING_SIZE],
+			  (len - PAYLOAD_DOWNLINK_SETTING_SIZE), &response[PAYLOAD_UPLINK_SETTING_SIZE]);
+	(void)payload_uplink_setting_encode(response, data[0], (int8_t)MIN(rc, 0));
 
-		memcpy(val, &bluetooth_fixed_passkey, sizeof(bluetooth_fixed_passkey));
-		return sizeof(bluetooth_fixed_passkey);
+	if (rc < 0) {
+		LOG_ERR("Setting %d downlink failed: %d", data[0], rc);
+		rc = 0;
 	}
-#endif
+
+	return uplink_queue_add(LORA_APP_PORT, UPLINK_QUEUE_PRIORITY_NORMAL, 0, response,
+				(PAYLOAD_UPLINK_SETTING_SIZE + rc));
+}
+
+DOWNLINK_HANDLER_DEFINE(setting_downlink_handler, LORA_DOWNLINK_TYPE_SETTING, setting_downlink);
 #endif
 
-	return -ENOENT;
+static void setting_load(const char *subtree)
+{
+	loading = true;
+
+	if (subtree == NULL) {
+		(void)settings_load();
+	} else {
+		(void)settings_load_subtree(subtree);
+	}
+
+	loading = false;
 }
 
-void app_keys_load(void)
+void setting_load_all(void)
 {
-	settings_load_subtree("app");
+	setting_load(NULL);
 }
 
-void app_keys_clear(void)
+/* LoRa keys */
+
+static int lora_keys_handle_set(const char *name, size_t len, settings_read_cb read_cb,
+				void *cb_arg)
 {
-	(void)settings_delete("app");
+	return setting_handle_set(SETTING_SUBTREE_LORA_KEYS, name, len, read_cb, cb_arg);
+}
+
+static int lora_keys_handle_get(const char *name, char *val, int val_len_max)
+{
+	return setting_handle_get(SETTING_SUBTREE_LORA_KEYS, name, val, val_len_max);
+}
+
+static int lora_keys_handle_export(int (*cb)(const char *name, const void *value, size_t val_len))
+{
+	return setting_handle_export(SETTING_SUBTREE_LORA_KEYS, cb);
+}
+
+static int setting_handle_commit(void)
+{
+	return setting_commit();
+}
+
+void lora_keys_load(void)
+{
+	settings_subsys_init();
+	setting_load("lora_keys");
+}
+
+void lora_keys_clear(void)
+{
+	setting_clear(SETTING_SUBTREE_LORA_KEYS);
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(lora_keys, "lora_keys", lora_keys_handle_get, lora_keys_handle_set,
+			       setting_handle_commit, lora_keys_handle_export);
+
+/* Application settings */
+
+static int app_handle_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+	return setting_handle_set(SETTING_SUBTREE_APP, name, len, read_cb, cb_arg);
+}
+
+static int app_handle_get(const char *name, char *val, int val_len_max)
+{
+	return setting_handle_get(SETTING_SUBTREE_APP, name, val, val_len_max);
+}
+
+static int app_handle_export(int (*cb)(const char *name, const void *value, size_t val_len))
+{
+	return setting_handle_export(SETTING_SUBTREE_APP, cb);
 }
 
-SETTINGS_STATIC_HANDLER_DEFINE(app, "app", app_handle_get, app_handle_set,
-			       app_handle_commit, app_handle_export);
-#else
 void app_keys_load(void)
 {
+	setting_load("app");
 }
 
 void app_keys_clear(void)
 {
+	setting_clear(SETTING_SUBTREE_APP);
 }
-#endif
+
+SETTINGS_STATIC_HANDLER_DEFINE(app, "app", app_handle_get, app_handle_set, setting_handle_commit,
+			       app_handle_export);
@@ -7,17 +7,50 @@
 #ifndef APP_SETTINGS_H
 #define APP_SETTINGS_H
 
+#include <zephyr/kernel.h>
+
 #define LORA_DEV_EUI_SIZE 8
 #define LORA_JOIN_EUI_SIZE 8
 #define LORA_APP_KEY_SIZE 16
 #define POWER_OFFSET_MV_SIZE 2
 #define BLUETOOTH_DEVICE_NAME_SIZE CONFIG_BT_DEVICE_NAME_MAX
 #define BLUETOOTH_FIXED_PASSKEY_SIZE 4
+#define REPORT_ON_CHANGE_SIZE 8
+
+/* Settings in the descriptor table (settings.c), the index of each setting in the table */
+enum setting_id_t {
+	SETTING_ID_LORA_DEV_EUI,
+	SETTING_ID_LORA_JOIN_EUI,
+	SETTING_ID_LORA_APP_KEY,
+#ifdef CONFIG_APP_EXTERNAL_DCDC
+	SETTING_ID_POWER_OFFSET,
+#endif
+#ifdef CONFIG_APP_REPORT_ON_CHANGE
+	SETTING_ID_REPORT_ON_CHANGE,
+#endif
+#ifdef CONFIG_BT
+	SETTING_ID_BLUETOOTH_NAME,
+#ifdef CONFIG_BT_FIXED_PASSKEY
+	SETTING_ID_BLUETOOTH_FIXED_PASSKEY,
+#endif
+#endif
+
+	SETTING_ID_COUNT
+};
 
+enum setting_validate_t {
+	/* Value must be exactly the size of the setting */
+	SETTING_VALIDATE_EXACT,
+	/* Value is a non-empty string without a NULL terminator, shorter than the setting */
+	SETTING_VALIDATE_STRING,
+};
+
+/* Index of settings which can be changed with setting downlinks, must not be reordered */
 enum lora_setting_index {
 	LORA_SETTING_INDEX_ADC_OFFSET,
 	LORA_SETTING_INDEX_BLUETOOTH_DEVICE_NAME,
 	LORA_SETTING_INDEX_BLUETOOTH_FIXED_PASSKEY,
+	LORA_SETTING_INDEX_REPORT_ON_CHANGE,
 
 	LORA_SETTING_INDEX_COUNT
 };
@@ -34,7 +67,102 @@ void app_keys_load(void);
 /* Clear application keys */
 void app_keys_clear(void);
 
-/* Set setting (from LoRa) */
-void setting_lora(enum lora_setting_index index, const uint8_t *data, uint8_t data_size);
+/* Find a setting by name (without the subtree), returns the setting ID or -ENOENT */
+int setting_find(const char *name);
+
+/* Get name (without the subtree) and size of a setting */
+const char *setting_name(enum setting_id_t id);
+uint8_t setting_size(enum setting_id_t id);
+
+/* Get a setting from the RAM cache, data must be the size of the setting, returns the length of
+ * the value or a negative error code
+ */
+int setting_get(enum setting_id_t id, void *data);
+
+/* Validate and save a setting, returns 0 on success or a negative error code. The value is only
+ * written to storage if it has changed, inside of a transaction it is written on commit
+ */
+int setting_set(enum setting_id_t id, const void *data, uint8_t data_size);
+
+/* Start a settings transaction, settings which are set are kept in RAM until the transaction is
+ * committed, transactions can be nested. Transactions which are not committed within
+ * CONFIG_APP_SETTINGS_TRANSACTION_TIMEOUT are committed automatically
+ */
+void setting_transaction_begin(void);
+
+/* Commit a settings transaction, when the outermost transaction is committed all changed
+ * settings are written to storage in one pass, returns 0 on success or a negative error code
+ */
+int setting_transaction_commit(void);
+
+/* Load all settings from storage (all subsystems) */
+void setting_load_all(void);
+
+/* Get LoRa keys from the RAM cache, all 0 if not set */
+static inline void lora_keys_get_dev_eui(uint8_t *dev_eui)
+{
+	(void)setting_get(SETTING_ID_LORA_DEV_EUI, dev_eui);
+}
+
+static inline void lora_keys_get_join_eui(uint8_t *join_eui)
+{
+	(void)setting_get(SETTING_ID_LORA_JOIN_EUI, join_eui);
+}
+
+static inline void lora_keys_get_app_key(uint8_t *app_key)
+{
+	(void)setting_get(SETTING_ID_LORA_APP_KEY, app_key);
+}
+
+#ifdef CONFIG_APP_EXTERNAL_DCDC
+/* Get power offset (in mV) from the RAM cache, 0 if not set */
+static inline int16_t app_keys_get_power_offset(void)
+{
+	int16_t power_offset;
+
+	(void)setting_get(SETTING_ID_POWER_OFFSET, &power_offset);
+
+	return power_offset;
+}
+#endif
+
+#ifdef CONFIG_BT
+/* Get Bluetooth device name from the RAM cache, name must be BLUETOOTH_DEVICE_NAME_SIZE bytes
+ * and is NULL terminated
+ */
+static inline void app_keys_get_bluetooth_name(char *name)
+{
+	(void)setting_get(SETTING_ID_BLUETOOTH_NAME, name);
+}
+
+#ifdef CONFIG_BT_FIXED_PASSKEY
+/* Get Bluetooth fixed passkey from the RAM cache */
+static inline uint32_t app_keys_get_bluetooth_fixed_passkey(void)
+{
+	uint32_t passkey;
+
+	(void)setting_get(SETTING_ID_BLUETOOTH_FIXED_PASSKEY, &passkey);
+
+	return passkey;
+}
+#endif
+#endif
+
+#ifdef CONFIG_APP_REPORT_ON_CHANGE
+/* Get report on change deadbands from the RAM cache, data must be REPORT_ON_CHANGE_SIZE bytes
+ * and is all 0 if not set
+ */
+static inline void app_keys_get_report_on_change(uint8_t *data)
+{
+	(void)setting_get(SETTING_ID_REPORT_ON_CHANGE, data);
+}
+#endif
+
+/* Set (if data_size is not 0) and get a setting by LoRa index, value must be at least the size
+ * of the setting, returns the length of the value (0 for write-only settings) or a negative
+ * error code
+ */
+int setting_lora(enum lora_setting_index index, const uint8_t *data, uint8_t data_size,
+		 uint8_t *value);
 
 #endif /* APP_SETTINGS_H */
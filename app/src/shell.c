@@ -9,80 +9,66 @@
 #include <zephyr/device.h>
 #include <zephyr/sys/util.h>
 #include <zephyr/shell/shell.h>
-#include <zephyr/settings/settings.h>
 #include "settings.h"
 
-#define READ_ARGS 1
-#define WRITE_ARGS 2
+#include "app.h"
+#include "lora.h"
+#include "hfclk.h"
+#include "uplink_queue.h"
 
-static int lora_dev_eui_handler(const struct shell *sh, size_t argc, char **argv)
-{
-	int rc = -EINVAL;
-	uint8_t dev_eui[LORA_DEV_EUI_SIZE] = { 0 };
+#ifdef CONFIG_APP_LORA_AIRTIME
+#include "airtime.h"
+#endif
 
-	if (argc == READ_ARGS) {
-		/* Read */
-		uint8_t print_buffer[LORA_DEV_EUI_SIZE * 2 + 1] = { 0 };
+#ifdef CONFIG_APP_LORA_CONFIRMED_PACKET_ADAPTIVE
+#include "link_quality.h"
+#endif
 
-		rc = settings_runtime_get("lora_keys/dev_eui", dev_eui, sizeof(dev_eui));
+#ifdef CONFIG_APP_ENERGY
+#include "energy.h"
+#endif
 
-		if (rc == sizeof(dev_eui)) {
-			rc = bin2hex(dev_eui, sizeof(dev_eui), print_buffer, sizeof(print_buffer));
+#ifdef CONFIG_APP_TRACE
+#include "trace.h"
+#endif
 
-			if (rc == (LORA_DEV_EUI_SIZE * 2)) {
-				shell_print(sh, "dev eui: %s", print_buffer);
-				rc = 0;
-			} else {
-				shell_error(sh, "Failed to convert to hex: %d", rc);
-			}
-		} else if (rc >= 0) {
-			shell_error(sh, "Invalid setting size");
-		} else {
-			shell_error(sh, "Invalid setting response: %d", rc);
-		}
-	} else if (argc == WRITE_ARGS) {
-		/* Write */
-		size_t data_size = strlen(argv[1]);
+#ifdef CONFIG_APP_FLASH_MAINTENANCE
+#include "flash_maintenance.h"
+#endif
 
-		if (data_size == (LORA_DEV_EUI_SIZE * 2)) {
-			rc = hex2bin(argv[1], data_size, dev_eui, sizeof(dev_eui));
+#define READ_ARGS 1
+#define WRITE_ARGS 2
 
-			if (rc == sizeof(dev_eui)) {
-				rc = settings_runtime_set("lora_keys/dev_eui", dev_eui, sizeof(dev_eui));
-				if (rc == 0) {
-					shell_print(sh, "dev eui updated");
-				} else {
-					shell_print(sh, "Failed to update dev eui: %d", rc);
-				}
-			} else {
-				shell_error(sh, "Invalid dev eui size");
-			}
-		} else {
-			shell_error(sh, "Invalid dev eui size");
-		}
-	} else {
-		shell_error(sh, "Invalid number of arguments");
+/* Get or set a setting as hex, the setting is found from the command name */
+static int setting_hex_handler(const struct shell *sh, size_t argc, char **argv)
+{
+	int rc = setting_find(argv[0]);
+	uint8_t value[LORA_APP_KEY_SIZE] = { 0 };
+	uint8_t size;
+
+	if (rc < 0) {
+		shell_error(sh, "Unknown setting");
+		return rc;
 	}
 
-	return rc;
-}
+	size = setting_size(rc);
 
-static int lora_join_eui_handler(const struct shell *sh, size_t argc, char **argv)
-{
-	int rc = -EINVAL;
-	uint8_t join_eui[LORA_JOIN_EUI_SIZE] = { 0 };
+	if (size > sizeof(value)) {
+		shell_error(sh, "Setting too large");
+		return -E2BIG;
+	}
 
 	if (argc == READ_ARGS) {
 		/* Read */
-		uint8_t print_buffer[LORA_JOIN_EUI_SIZE * 2 + 1] = { 0 };
+		uint8_t print_buffer[sizeof(value) * 2 + 1] = { 0 };
 
-		rc = settings_runtime_get("lora_keys/join_eui", join_eui, sizeof(join_eui));
+		rc = setting_get(rc, value);
 
-		if (rc == sizeof(join_eui)) {
-			rc = bin2hex(join_eui, sizeof(join_eui), print_buffer, sizeof(print_buffer));
+		if (rc == size) {
+			rc = bin2hex(value, size, print_buffer, sizeof(print_buffer));
 
-			if (rc == (LORA_JOIN_EUI_SIZE * 2)) {
-				shell_print(sh, "join eui: %s", print_buffer);
+			if (rc == (size * 2)) {
+				shell_print(sh, "%s: %s", argv[0], print_buffer);
 				rc = 0;
 			} else {
 				shell_error(sh, "Failed to convert to hex: %d", rc);
@@ -94,176 +80,142 @@ static int lora_join_eui_handler(const struct shell *sh, size_t argc, char **arg
 		}
 	} else if (argc == WRITE_ARGS) {
 		/* Write */
+		int id = rc;
 		size_t data_size = strlen(argv[1]);
 
-		if (data_size == (LORA_JOIN_EUI_SIZE * 2)) {
-			rc = hex2bin(argv[1], data_size, join_eui, sizeof(join_eui));
+		if (data_size == (size * 2) && hex2bin(argv[1], data_size, value, size) == size) {
+			rc = setting_set(id, value, size);
 
-			if (rc == sizeof(join_eui)) {
-				rc = settings_runtime_set("lora_keys/join_eui", join_eui, sizeof(join_eui));
-				if (rc == 0) {
-					shell_print(sh, "join eui updated");
-				} else {
-					shell_print(sh, "Failed to update join eui: %d", rc);
-				}
+			if (rc == 0) {
+				shell_print(sh, "%s updated", argv[0]);
 			} else {
-				shell_error(sh, "Invalid join eui size");
+				shell_print(sh, "Failed to update %s: %d", argv[0], rc);
 			}
 		} else {
-			shell_error(sh, "Invalid join eui size");
+			shell_error(sh, "Invalid %s size", argv[0]);
+			rc = -EINVAL;
 		}
 	} else {
 		shell_error(sh, "Invalid number of arguments");
+		rc = -EINVAL;
 	}
 
 	return rc;
 }
 
-static int lora_app_key_handler(const struct shell *sh, size_t argc, char **argv)
+#if 0
+static int lora_dev_nonce_handler(const struct shell *sh, size_t argc, char **argv)
 {
-	int rc = -EINVAL;
-	uint8_t app_key[LORA_APP_KEY_SIZE] = { 0 };
+	int err;
 
-	if (argc == READ_ARGS) {
-		/* Read */
-		uint8_t print_buffer[LORA_APP_KEY_SIZE * 2 + 1] = { 0 };
+	shell_print(sh, "TODO");
 
-		rc = settings_runtime_get("lora_keys/app_key", app_key, sizeof(app_key));
+	return 0;
+}
+#endif
 
-		if (rc == sizeof(app_key)) {
-			rc = bin2hex(app_key, sizeof(app_key), print_buffer, sizeof(print_buffer));
+static int lora_status_handler(const struct shell *sh, size_t argc, char **argv)
+{
+#ifdef CONFIG_APP_LORA_AIRTIME
+	static const char * const traffic_class_names[LORA_TRAFFIC_CLASS_COUNT] = {
+		[LORA_TRAFFIC_CLASS_READINGS] = "readings",
+		[LORA_TRAFFIC_CLASS_ACK] = "ack",
+		[LORA_TRAFFIC_CLASS_SMP] = "smp",
+	};
+	struct airtime_usage_t usage;
+	uint8_t i = 0;
+#endif
+#ifdef CONFIG_APP_LORA_CONFIRMED_PACKET_ADAPTIVE
+	struct link_quality_status_t link_status;
+#endif
+	struct lora_status_t status;
 
-			if (rc == (LORA_APP_KEY_SIZE * 2)) {
-				shell_print(sh, "app key: %s", print_buffer);
-				rc = 0;
-			} else {
-				shell_error(sh, "Failed to convert to hex: %d", rc);
-			}
-		} else if (rc >= 0) {
-			shell_error(sh, "Invalid setting size");
-		} else {
-			shell_error(sh, "Invalid setting response: %d", rc);
-		}
-	} else if (argc == WRITE_ARGS) {
-		/* Write */
-		size_t data_size = strlen(argv[1]);
+	lora_get_status(&status);
 
-		if (data_size == (LORA_APP_KEY_SIZE * 2)) {
-			rc = hex2bin(argv[1], data_size, app_key, sizeof(app_key));
+	/* TX power is managed by the LoRaWAN stack (ADR) and is not available from its API */
+	shell_print(sh, "State: %s", (status.joined == true ? "joined" : "not joined"));
+	shell_print(sh, "Datarate: DR%d", status.datarate);
+	/* Counted by the application since boot, the LoRaWAN frame counters are not available from
+	 * the stack API
+	 */
+	shell_print(sh, "Uplinks: %u sent, %u failed", status.uplinks, status.uplink_failures);
+	shell_print(sh, "Downlinks: %u received", status.downlinks);
 
-			if (rc == sizeof(app_key)) {
-				rc = settings_runtime_set("lora_keys/app_key", app_key, sizeof(app_key));
-				if (rc == 0) {
-					shell_print(sh, "app key updated");
-				} else {
-					shell_print(sh, "Failed to update app key: %d", rc);
-				}
-			} else {
-				shell_error(sh, "Invalid app key size");
-			}
-		} else {
-			shell_error(sh, "Invalid app key size");
-		}
-	} else {
-		shell_error(sh, "Invalid number of arguments");
+	if (status.downlinks > 0) {
+		shell_print(sh, "Last downlink: RSSI %ddBm, SNR %ddB", status.rssi, status.snr);
 	}
 
-	return rc;
-}
+#ifdef CONFIG_APP_LORA_CONFIRMED_PACKET_ADAPTIVE
+	link_quality_get_status(&link_status);
 
-#ifdef CONFIG_ADC
-static int app_power_offset_handler(const struct shell *sh, size_t argc, char **argv)
-{
-	int rc = -EINVAL;
-	uint8_t power_offset[POWER_OFFSET_MV_SIZE] = { 0 };
-
-	if (argc == READ_ARGS) {
-		/* Read */
-		uint8_t print_buffer[POWER_OFFSET_MV_SIZE * 2 + 1] = { 0 };
-
-		rc = settings_runtime_get("app/power_offset", power_offset, sizeof(power_offset));
-
-		if (rc == sizeof(power_offset)) {
-			rc = bin2hex(power_offset, sizeof(power_offset), print_buffer, sizeof(print_buffer));
+	if (link_status.downlinks > 0) {
+		shell_print(sh, "Downlink: RSSI %ddBm, SNR %ddB (%d received)", link_status.rssi,
+			    link_status.snr, link_status.downlinks);
+	}
 
-			if (rc == (POWER_OFFSET_MV_SIZE * 2)) {
-				shell_print(sh, "power offset: %s", print_buffer);
-				rc = 0;
-			} else {
-				shell_error(sh, "Failed to convert to hex: %d", rc);
-			}
-		} else if (rc >= 0) {
-			shell_error(sh, "Invalid setting size");
-		} else {
-			shell_error(sh, "Invalid setting response: %d", rc);
-		}
-	} else if (argc == WRITE_ARGS) {
-		/* Write */
-		size_t data_size = strlen(argv[1]);
+	shell_print(sh, "Confirmed interval: %d (%d sent since last), %d acks missed",
+		    link_status.interval, link_status.unconfirmed, link_status.acks_missed);
+#endif
 
-		if (data_size == (POWER_OFFSET_MV_SIZE * 2)) {
-			rc = hex2bin(argv[1], data_size, power_offset, sizeof(power_offset));
+#ifdef CONFIG_APP_LORA_AIRTIME
+	shell_print(sh, "Airtime budget: %dms/hour, %dms/day", CONFIG_APP_LORA_AIRTIME_HOUR_BUDGET,
+		    CONFIG_APP_LORA_AIRTIME_DAY_BUDGET);
 
-			if (rc == sizeof(power_offset)) {
-				rc = settings_runtime_set("app/power_offset", power_offset, sizeof(power_offset));
-				if (rc == 0) {
-					shell_print(sh, "power offset updated");
-				} else {
-					shell_print(sh, "Failed to update power offset: %d", rc);
-				}
-			} else {
-				shell_error(sh, "Invalid power offset size");
-			}
-		} else {
-			shell_error(sh, "Invalid power offset size");
-		}
-	} else {
-		shell_error(sh, "Invalid number of arguments");
+	while (i < LORA_TRAFFIC_CLASS_COUNT) {
+		airtime_get_usage(i, &usage);
+		shell_print(sh, "Airtime %s: %dms/hour, %dms/day", traffic_class_names[i], usage.hour,
+			    usage.day);
+		++i;
 	}
+#endif
 
-	return rc;
+	return 0;
 }
-#endif
 
-#if 0
-static int lora_dev_nonce_handler(const struct shell *sh, size_t argc, char **argv)
+static int lora_clear_handler(const struct shell *sh, size_t argc, char **argv)
 {
-	int err;
+	lora_keys_clear();
 
-	shell_print(sh, "TODO");
+	shell_print(sh, "LoRa keys cleared");
 
 	return 0;
 }
-#endif
 
-static int lora_status_handler(const struct shell *sh, size_t argc, char **argv)
+static int lora_begin_handler(const struct shell *sh, size_t argc, char **argv)
 {
-	int err;
+	setting_transaction_begin();
 
-	shell_print(sh, "TODO");
+	shell_print(sh, "Settings will be saved on commit (or after %ds)",
+		    CONFIG_APP_SETTINGS_TRANSACTION_TIMEOUT);
 
 	return 0;
 }
 
-static int lora_clear_handler(const struct shell *sh, size_t argc, char **argv)
+static int lora_commit_handler(const struct shell *sh, size_t argc, char **argv)
 {
-	lora_keys_clear();
+	int rc = setting_transaction_commit();
 
-	shell_print(sh, "LoRa keys cleared");
+	if (rc == 0) {
+		shell_print(sh, "Settings saved");
+	} else {
+		shell_error(sh, "Failed to save settings: %d", rc);
+	}
 
-	return 0;
+	return rc;
 }
 
 SHELL_STATIC_SUBCMD_SET_CREATE(lora_cmd,
 	/* Command handlers */
-	SHELL_CMD(dev_eui, NULL, "Get/set LoRa dev EUI", lora_dev_eui_handler),
-	SHELL_CMD(join_eui, NULL, "Get/set LoRa join EUI", lora_join_eui_handler),
-	SHELL_CMD(app_key, NULL, "Get/set LoRa application key", lora_app_key_handler),
+	SHELL_CMD(dev_eui, NULL, "Get/set LoRa dev EUI", setting_hex_handler),
+	SHELL_CMD(join_eui, NULL, "Get/set LoRa join EUI", setting_hex_handler),
+	SHELL_CMD(app_key, NULL, "Get/set LoRa application key", setting_hex_handler),
 #if 0
 	SHELL_CMD(dev_nonce, NULL, "Get/set LoRa device nonce", lora_dev_nonce_handler),
 #endif
 	SHELL_CMD(status, NULL, "Show LoRa status", lora_status_handler),
 	SHELL_CMD(clear, NULL, "Clear LoRa configuration", lora_clear_handler),
+	SHELL_CMD(begin, NULL, "Start a batched settings update", lora_begin_handler),
+	SHELL_CMD(commit, NULL, "Save a batched settings update", lora_commit_handler),
 
 	/* Array terminator. */
 	SHELL_SUBCMD_SET_END
@@ -273,39 +225,262 @@ SHELL_CMD_REGISTER(lora, &lora_cmd, "LoRa commands", NULL);
 
 static int app_disable_handler(const struct shell *sh, size_t argc, char **argv)
 {
-	int err;
+	app_readings_enable(false);
 
-	shell_print(sh, "TODO");
+	shell_print(sh, "Readings disabled");
 
 	return 0;
 }
 
 static int app_enable_handler(const struct shell *sh, size_t argc, char **argv)
 {
-	int err;
+	app_readings_enable(true);
 
-	shell_print(sh, "TODO");
+	shell_print(sh, "Readings enabled");
 
 	return 0;
 }
 
+#if defined(CONFIG_INIT_STACKS) && defined(CONFIG_THREAD_STACK_INFO) && \
+	defined(CONFIG_THREAD_MONITOR)
+static void app_status_thread(const struct k_thread *thread, void *user_data)
+{
+	const struct shell *sh = user_data;
+	const char *name = k_thread_name_get((k_tid_t)thread);
+	size_t unused;
+
+	if (k_thread_stack_space_get(thread, &unused) == 0) {
+		shell_print(sh, "Stack %s: %zu/%zu bytes unused",
+			    (name != NULL && name[0] != '\0' ? name : "?"), unused,
+			    thread->stack_info.size);
+	}
+}
+#endif
+
+#ifdef CONFIG_APP_TRACE
+/* Show the duration and result of the last completed call of a trace point, found by searching
+ * the trace buffer backwards for its exit event and the enter event before it
+ */
+static void app_status_trace(const struct shell *sh, enum trace_point_t point, const char *name)
+{
+	struct trace_event_t event;
+	uint16_t i = trace_count();
+	bool exited = false;
+	uint32_t exit_cycles = 0;
+	int16_t result = 0;
+
+	while (i > 0) {
+		--i;
+
+		if (trace_read(i, &event, 1) != 1 || event.point != point) {
+			continue;
+		}
+
+		if (event.kind == TRACE_KIND_EXIT) {
+			exited = true;
+			exit_cycles = event.cycles;
+			result = event.result;
+		} else if (exited == true) {
+			shell_print(sh, "Last %s: %uus (%d)", name,
+				    k_cyc_to_us_floor32(exit_cycles - event.cycles), result);
+			return;
+		}
+	}
+
+	shell_print(sh, "Last %s: not in trace buffer", name);
+}
+#endif
+
 static int app_status_handler(const struct shell *sh, size_t argc, char **argv)
 {
-	int err;
+	struct app_status_t status;
+	struct hfclk_status_t hfclk_status;
+#ifdef CONFIG_APP_ENERGY
+	struct energy_status_t energy_status;
+#endif
 
-	shell_print(sh, "TODO");
+	app_get_status(&status);
+	hfclk_get_status(&hfclk_status);
+
+	shell_print(sh, "Readings: %s, every %us",
+		    (status.readings_enabled == true ? "enabled" : "disabled"),
+		    status.sensor_reading_time);
+#ifdef CONFIG_APP_TRACE
+	app_status_trace(sh, TRACE_POINT_SENSOR_FETCH, "sensor fetch");
+#ifdef CONFIG_ADC
+	app_status_trace(sh, TRACE_POINT_ADC_READ, "ADC read");
+#endif
+#else
+	shell_print(sh, "Last sensor fetch and ADC read: unavailable (enable CONFIG_APP_TRACE)");
+#endif
+	shell_print(sh, "Queue: %u queued, %u dropped", uplink_queue_get_count(),
+		    uplink_queue_get_drops());
+#ifdef CONFIG_APP_ENERGY
+	energy_get_status(&energy_status);
+	shell_print(sh, "HFCLK: %u users, %ums on", hfclk_status.count,
+		    energy_status.active_ms[ENERGY_CONSUMER_HFCLK]);
+#else
+	shell_print(sh, "HFCLK: %u users, on time unavailable (enable CONFIG_APP_ENERGY)",
+		    hfclk_status.count);
+#endif
+
+#if defined(CONFIG_INIT_STACKS) && defined(CONFIG_THREAD_STACK_INFO) && \
+	defined(CONFIG_THREAD_MONITOR)
+	k_thread_foreach_unlocked(app_status_thread, (void *)sh);
+#else
+	shell_print(sh, "Stacks: unavailable (enable CONFIG_INIT_STACKS, CONFIG_THREAD_STACK_INFO "
+		    "and CONFIG_THREAD_MONITOR)");
+#endif
 
 	return 0;
 }
 
+#ifdef CONFIG_APP_ENERGY
+static int app_energy_handler(const struct shell *sh, size_t argc, char **argv)
+{
+	struct energy_status_t status;
+	uint8_t i = 0;
+
+	energy_get_status(&status);
+
+	while (i < ENERGY_CONSUMER_COUNT) {
+		shell_print(sh, "%s: %ums", energy_consumer_name(i), status.active_ms[i]);
+		++i;
+	}
+
+	shell_print(sh, "Estimated consumption: %uuAh/day", status.uah_per_day);
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_APP_FLASH_MAINTENANCE
+static int app_flash_handler(const struct shell *sh, size_t argc, char **argv)
+{
+	struct flash_maintenance_stats_t stats;
+	int rc = flash_maintenance_get_stats(&stats);
+
+	if (rc != 0) {
+		shell_error(sh, "Failed to get flash stats: %d", rc);
+		return rc;
+	}
+
+	shell_print(sh, "Sectors: %u x %u bytes", stats.sector_count, stats.sector_size);
+	shell_print(sh, "Free: %u bytes (%u in current sector)", stats.free, stats.sector_free);
+	shell_print(sh, "Erases: %u (%u per sector)", stats.erases,
+		    (stats.erases / stats.sector_count));
+	shell_print(sh, "Written since boot: %u bytes (%u bytes of data)", stats.bytes_written,
+		    stats.data_bytes);
+	shell_print(sh, "Idle garbage collections: %u", stats.gc_runs);
+	shell_print(sh, "Write amplification: %u.%02u", (stats.write_amplification / 100),
+		    (stats.write_amplification % 100));
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_APP_SUSPEND
+static int app_suspend_handler(const struct shell *sh, size_t argc, char **argv)
+{
+	unsigned long wake_time = 0;
+	int rc = 0;
+
+	if (argc == 2) {
+		wake_time = shell_strtoul(argv[1], 10, &rc);
+
+		if (rc != 0 || wake_time > UINT32_MAX) {
+			shell_error(sh, "Invalid wake time");
+			return -EINVAL;
+		}
+	}
+
+	app_suspend((uint32_t)wake_time);
+
+	if (wake_time == 0) {
+		shell_print(sh, "Entering System OFF, press button to wake");
+	} else {
+		shell_print(sh, "Suspending for %lus", wake_time);
+	}
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_APP_TRACE
+static int app_trace_handler(const struct shell *sh, size_t argc, char **argv)
+{
+	/* Cycle count of the last enter event of each point, to show durations on exit */
+	uint32_t enter_cycles[TRACE_POINT_COUNT] = { 0 };
+	bool entered[TRACE_POINT_COUNT] = { false };
+	struct trace_event_t event;
+	uint16_t i = 0;
+
+	shell_print(sh, "%d events, %d lost", trace_count(), trace_lost());
+
+	while (trace_read(i, &event, 1) == 1) {
+		uint32_t time_us = k_cyc_to_us_floor32(event.cycles);
+
+		if (event.point >= TRACE_POINT_COUNT) {
+			++i;
+			continue;
+		}
+
+		if (event.kind == TRACE_KIND_ENTER) {
+			enter_cycles[event.point] = event.cycles;
+			entered[event.point] = true;
+			shell_print(sh, "%10u %-8s enter", time_us, trace_point_name(event.point));
+		} else if (entered[event.point] == true) {
+			entered[event.point] = false;
+			shell_print(sh, "%10u %-8s exit %d (%uus)", time_us,
+				    trace_point_name(event.point), event.result,
+				    k_cyc_to_us_floor32(event.cycles - enter_cycles[event.point]));
+		} else {
+			shell_print(sh, "%10u %-8s exit %d", time_us, trace_point_name(event.point),
+				    event.result);
+		}
+
+		++i;
+	}
+
+	return 0;
+}
+
+static int app_trace_clear_handler(const struct shell *sh, size_t argc, char **argv)
+{
+	trace_clear();
+
+	shell_print(sh, "Trace cleared");
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(app_trace_cmd,
+	SHELL_CMD(clear, NULL, "Clear trace buffer", app_trace_clear_handler),
+	SHELL_SUBCMD_SET_END
+);
+#endif
+
 SHELL_STATIC_SUBCMD_SET_CREATE(app_cmd,
 	/* Command handlers */
-	SHELL_CMD(disable, NULL, "Disable fetching readings", app_enable_handler),
+	SHELL_CMD(disable, NULL, "Disable fetching readings", app_disable_handler),
 	SHELL_CMD(enable, NULL, "Enable fetching readings", app_enable_handler),
 	SHELL_CMD(status, NULL, "Show device status", app_status_handler),
 
-#ifdef CONFIG_ADC
-	SHELL_CMD(power_offset, NULL, "Get/set application power offset (mV)", app_power_offset_handler),
+#ifdef CONFIG_APP_EXTERNAL_DCDC
+	SHELL_CMD(power_offset, NULL, "Get/set application power offset (mV)", setting_hex_handler),
+#endif
+#ifdef CONFIG_APP_ENERGY
+	SHELL_CMD(energy, NULL, "Show active time and estimated energy usage", app_energy_handler),
+#endif
+#ifdef CONFIG_APP_FLASH_MAINTENANCE
+	SHELL_CMD(flash, NULL, "Show settings flash usage and wear", app_flash_handler),
+#endif
+#ifdef CONFIG_APP_SUSPEND
+	SHELL_CMD_ARG(suspend, NULL, "Suspend sampling until [seconds] or button press",
+		      app_suspend_handler, 1, 1),
+#endif
+#ifdef CONFIG_APP_TRACE
+	SHELL_CMD(trace, &app_trace_cmd, "Show trace buffer", app_trace_handler),
 #endif
 
 	/* Array terminator. */
@@ -14,9 +14,15 @@
 #include <mgmt/mcumgr/transport/smp_internal.h>
 #include <mgmt/mcumgr/transport/smp_reassembly.h>
 
-#include "error_messages.h"
+#include "uplink_queue.h"
+#include "backoff.h"
+
+#if defined(CONFIG_APP_LORA_AIRTIME) || defined(CONFIG_APP_ENERGY)
+#include "airtime.h"
+#endif
 
 #define SMP_LORAWAN_TRANSPORT SMP_USER_DEFINED_TRANSPORT
+#define SMP_LORAWAN_SEND_TRIES 3
 
 extern int hfclk_enable(void);
 extern int hfclk_disable(void);
@@ -47,12 +53,56 @@ struct smp_client_transport_entry smp_lorawan_client_transport = {
 };
 #endif
 
+static struct backoff_t smp_backoff = BACKOFF_INIT(CONFIG_APP_LORA_SEND_BACKOFF_BASE,
+						   CONFIG_APP_LORA_SEND_BACKOFF_CAP);
+
 struct smp_lorawan_uplink_message_t {
 	void *fifo_reserved;
 	struct net_buf *nb;
 	struct k_sem my_sem;
 };
 
+/* Send a single LoRaWAN packet, returns -EAGAIN if the SMP airtime budget has been used */
+static int smp_lorawan_send(uint8_t *data, uint8_t data_size)
+{
+	int rc = 0;
+	uint8_t tries = SMP_LORAWAN_SEND_TRIES;
+
+#ifdef CONFIG_APP_LORA_AIRTIME
+	if (airtime_allowed(LORA_TRAFFIC_CLASS_SMP, data_size) == false) {
+		LOG_WRN("LoRaWAN SMP airtime budget used, dropping packet");
+		return -EAGAIN;
+	}
+#endif
+
+	while (tries > 0) {
+#ifdef CONFIG_APP_LORA_AIRTIME
+		airtime_record(LORA_TRAFFIC_CLASS_SMP, data_size);
+#endif
+
+		rc = lorawan_send(CONFIG_MCUMGR_TRANSPORT_LORAWAN_PORT, data, data_size,
+				  (CONFIG_MCUMGR_TRANSPORT_LORAWAN_CONFIRMED_PACKETS ?
+				   LORAWAN_MSG_CONFIRMED : LORAWAN_MSG_UNCONFIRMED));
+
+#ifdef CONFIG_APP_ENERGY
+		airtime_energy_record(data_size);
+#endif
+
+		if (rc == 0) {
+			backoff_reset(&smp_backoff);
+			break;
+		}
+
+		--tries;
+
+		if (tries > 0) {
+			backoff_sleep(&smp_backoff);
+		}
+	}
+
+	return rc;
+}
+
 #ifdef CONFIG_MCUMGR_TRANSPORT_LORAWAN_POLL_FOR_DATA
 static struct k_thread smp_lorawan_thread;
 K_KERNEL_STACK_MEMBER(smp_lorawan_stack, 1650);
@@ -81,7 +131,7 @@ static void smp_lorawan_uplink_thread(void *p1, void *p2, void *p3)
 			uint8_t *data = NULL;
 			uint8_t data_size;
 			uint8_t temp;
-			uint8_t tries = 3;
+			int rc;
 
 			lorawan_get_payload_sizes(&data_size, &temp);
 
@@ -93,21 +143,10 @@ static void smp_lorawan_uplink_thread(void *p1, void *p2, void *p3)
 				data = net_buf_pull_mem(msg->nb, data_size);
 			}
 
-			while (tries > 0) {
-				int rc;
-
-				rc = lorawan_send(CONFIG_MCUMGR_TRANSPORT_LORAWAN_PORT, data, data_size,
-						  (CONFIG_MCUMGR_TRANSPORT_LORAWAN_CONFIRMED_PACKETS ?
-						   LORAWAN_MSG_CONFIRMED : LORAWAN_MSG_UNCONFIRMED));
+			rc = smp_lorawan_send(data, data_size);
 
-				if (rc != 0) {
-					--tries;
-				} else {
-					break;
-				}
-			}
-
-			if (size == 0) {
+			if (size == 0 || rc == -EAGAIN) {
+				/* Remaining fragments are dropped if the airtime budget has been used */
 				break;
 			}
 
@@ -162,9 +201,8 @@ LOG_ERR("smp reassembly finished");
 			        k_fifo_put(&smp_lorawan_fifo, &empty_message);
 #else
 				/* Queue empty message */
-				error_message_lock();
-				error_message_add_error(NULL, 0);
-				error_message_unlock();
+				(void)uplink_queue_add(CONFIG_MCUMGR_TRANSPORT_LORAWAN_PORT,
+						       UPLINK_QUEUE_PRIORITY_NORMAL, 0, NULL, 0);
 #endif
 			}
 		}
@@ -203,7 +241,6 @@ static int smp_lorawan_uplink(struct net_buf *nb)
 		uint8_t *data = NULL;
 		uint8_t data_size;
 		uint8_t temp;
-		uint8_t tries = 3;
 
 		lorawan_get_payload_sizes(&data_size, &temp);
 
@@ -212,19 +249,11 @@ static int smp_lorawan_uplink(struct net_buf *nb)
 		}
 
 		data = net_buf_pull_mem(nb, data_size);
+		rc = smp_lorawan_send(data, data_size);
 
-		while (tries > 0) {
-			int rc;
-
-			rc = lorawan_send(CONFIG_MCUMGR_TRANSPORT_LORAWAN_PORT, data, data_size,
-					  (CONFIG_MCUMGR_TRANSPORT_LORAWAN_CONFIRMED_PACKETS ?
-					   LORAWAN_MSG_CONFIRMED : LORAWAN_MSG_UNCONFIRMED));
-
-			if (rc != 0) {
-				--tries;
-			} else {
-				break;
-			}
+		if (rc == -EAGAIN) {
+			/* Remaining fragments are dropped if the airtime budget has been used */
+			break;
 		}
 
 		pos += data_size;
@@ -239,9 +268,7 @@ static int smp_lorawan_uplink(struct net_buf *nb)
 		LOG_ERR("Cannot send LoRaWAN SMP message, too large. Message: %d, maximum: %d",
 			nb->len, data_size);
 	} else {
-		rc = lorawan_send(CONFIG_MCUMGR_TRANSPORT_LORAWAN_PORT, nb->data, nb->len,
-				  (CONFIG_MCUMGR_TRANSPORT_LORAWAN_CONFIRMED_PACKETS ?
-				   LORAWAN_MSG_CONFIRMED : LORAWAN_MSG_UNCONFIRMED));
+		rc = smp_lorawan_send(nb->data, nb->len);
 
 		if (rc != 0) {
 			LOG_ERR("Failed to send LoRaWAN SMP message: %d", rc);
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/sys/poweroff.h>
+#include <zephyr/logging/log.h>
+#include "suspend.h"
+#include "app.h"
+#include "watchdog.h"
+
+LOG_MODULE_REGISTER(suspend, CONFIG_APP_SUSPEND_LOG_LEVEL);
+
+#define BUTTON_ALIAS DT_ALIAS(sw0)
+
+/* Button must be released before System OFF, otherwise it would wake the device immediately */
+#define SUSPEND_RELEASE_POLL_TIME K_MSEC(50)
+#define SUSPEND_RELEASE_POLLS 200
+
+/* Watchdog times out after 7 minutes, it keeps running whilst idle in System ON */
+#define SUSPEND_WATCHDOG_FEED_TIME_MS (5 * MSEC_PER_SEC * SEC_PER_MIN)
+
+#if DT_NODE_HAS_STATUS(BUTTON_ALIAS, okay)
+#define SUSPEND_HAS_BUTTON
+
+static const struct gpio_dt_spec button = GPIO_DT_SPEC_GET(BUTTON_ALIAS, gpios);
+static struct gpio_callback button_cb_data;
+
+#if CONFIG_APP_SUSPEND_BUTTON_HOLD_TIME > 0
+static void button_hold_handler(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(button_hold_work, button_hold_handler);
+#endif
+#endif
+
+static K_SEM_DEFINE(resume_sem, 0, 1);
+/* Set from the main thread and read from the button interrupt */
+static atomic_t suspended = ATOMIC_INIT(0);
+
+#ifdef SUSPEND_HAS_BUTTON
+#if CONFIG_APP_SUSPEND_BUTTON_HOLD_TIME > 0
+static void button_hold_handler(struct k_work *work)
+{
+	if (gpio_pin_get_dt(&button) > 0) {
+		LOG_INF("Button held, suspending");
+		app_suspend(0);
+	}
+}
+#endif
+
+static void button_pressed(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+	if (atomic_get(&suspended) != 0) {
+		k_sem_give(&resume_sem);
+	}
+
+#if CONFIG_APP_SUSPEND_BUTTON_HOLD_TIME > 0
+	(void)k_work_reschedule(&button_hold_work, K_SECONDS(CONFIG_APP_SUSPEND_BUTTON_HOLD_TIME));
+#endif
+}
+#endif
+
+int suspend_init(void)
+{
+#ifdef SUSPEND_HAS_BUTTON
+	int rc;
+
+	if (!gpio_is_ready_dt(&button)) {
+		LOG_ERR("Button GPIO device not ready: %s", button.port->name);
+		return -ENODEV;
+	}
+
+	/* Same configuration as the other users of the button, so this does not change it */
+	rc = gpio_pin_configure_dt(&button, GPIO_INPUT);
+
+	if (rc != 0) {
+		LOG_ERR("Button pin configure failed: %d", rc);
+		return rc;
+	}
+
+	rc = gpio_pin_interrupt_configure_dt(&button, GPIO_INT_EDGE_TO_ACTIVE);
+
+	if (rc != 0) {
+		LOG_ERR("Button interrupt configure failed: %d", rc);
+		return rc;
+	}
+
+	gpio_init_callback(&button_cb_data, button_pressed, BIT(button.pin));
+
+	return gpio_add_callback(button.port, &button_cb_data);
+#else
+	return 0;
+#endif
+}
+
+FUNC_NORETURN void suspend_system_off(void)
+{
+#ifdef SUSPEND_HAS_BUTTON
+	uint8_t polls = 0;
+
+	while (gpio_pin_get_dt(&button) > 0 && polls < SUSPEND_RELEASE_POLLS) {
+		k_sleep(SUSPEND_RELEASE_POLL_TIME);
+		++polls;
+	}
+
+	/* Level interrupts use GPIO sense, which wakes the device from System OFF */
+	(void)gpio_pin_interrupt_configure_dt(&button, GPIO_INT_LEVEL_ACTIVE);
+	LOG_INF("Entering System OFF, press button to wake");
+#else
+	LOG_WRN("Entering System OFF, no button so device will only wake on reset");
+#endif
+
+	LOG_PANIC();
+	sys_poweroff();
+}
+
+void suspend_wait(uint32_t wake_time)
+{
+	int64_t end = k_uptime_get() + ((int64_t)wake_time * MSEC_PER_SEC);
+
+	LOG_INF("Suspended for %us", wake_time);
+	k_sem_reset(&resume_sem);
+	(void)atomic_set(&suspended, 1);
+
+	while (1) {
+		int64_t remaining = end - k_uptime_get();
+
+		if (remaining <= 0) {
+			break;
+		}
+
+		remaining = MIN(remaining, SUSPEND_WATCHDOG_FEED_TIME_MS);
+
+		if (k_sem_take(&resume_sem, K_MSEC(remaining)) == 0) {
+			LOG_INF("Woken by button");
+			break;
+		}
+
+		watchdog_feed();
+	}
+
+	(void)atomic_set(&suspended, 0);
+}
@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_SUSPEND_H
+#define APP_SUSPEND_H
+
+#include <zephyr/kernel.h>
+
+/* Setup suspend button, holding the button suspends the device until the button is pressed */
+int suspend_init(void);
+
+/* Enter System OFF, the device is woken (with a reset) by the button, does not return */
+FUNC_NORETURN void suspend_system_off(void);
+
+/* Stay idle in System ON until wake_time (in seconds) has elapsed or the button is pressed, the
+ * nRF51 cannot be woken from System OFF by the RTC so this is used for suspends with a deadline
+ */
+void suspend_wait(uint32_t wake_time);
+
+#endif /* APP_SUSPEND_H */
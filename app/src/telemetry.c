@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/drivers/hwinfo.h>
+#include "telemetry.h"
+#include "uplink_queue.h"
+#include "protocol.h"
+#include "lora.h"
+#include "flash_maintenance.h"
+
+LOG_MODULE_REGISTER(telemetry, CONFIG_APP_TELEMETRY_LOG_LEVEL);
+
+/* Value used for fields which are not available */
+#define TELEMETRY_UNKNOWN UINT16_MAX
+
+static uint16_t reset_cause = 0;
+static uint16_t boot_count = 0;
+static uint16_t counters[TELEMETRY_COUNTER_COUNT];
+static uint16_t min_voltage = TELEMETRY_UNKNOWN;
+static struct k_spinlock telemetry_lock;
+
+static int telemetry_handle_set(const char *name, size_t len, settings_read_cb read_cb,
+				void *cb_arg)
+{
+	const char *next;
+	int rc;
+
+	if (settings_name_steq(name, "boot_count", &next) && !next) {
+		if (len != sizeof(boot_count)) {
+			return -EINVAL;
+		}
+
+		rc = read_cb(cb_arg, &boot_count, sizeof(boot_count));
+
+		return (rc < 0 ? rc : 0);
+	}
+
+	return -ENOENT;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(telemetry, "telemetry", NULL, telemetry_handle_set, NULL, NULL);
+
+/* Get the minimum unused stack space (in bytes) a thread has had */
+static uint16_t telemetry_stack_unused(const struct k_thread *thread)
+{
+#if defined(CONFIG_INIT_STACKS) && defined(CONFIG_THREAD_STACK_INFO)
+	size_t unused;
+
+	if (k_thread_stack_space_get(thread, &unused) == 0) {
+		return (uint16_t)MIN(unused, (TELEMETRY_UNKNOWN - 1));
+	}
+#endif
+
+	return TELEMETRY_UNKNOWN;
+}
+
+void telemetry_init(void)
+{
+	int rc;
+
+#ifdef CONFIG_HWINFO
+	uint32_t cause;
+
+	if (hwinfo_get_reset_cause(&cause) == 0) {
+		/* All hwinfo reset cause flags fit in the low 16 bits */
+		reset_cause = (uint16_t)cause;
+		(void)hwinfo_clear_reset_cause();
+	}
+#endif
+
+	(void)settings_load_subtree("telemetry");
+
+	if (boot_count < UINT16_MAX) {
+		++boot_count;
+	}
+
+	flash_maintenance_write_start();
+	rc = settings_save_one("telemetry/boot_count", &boot_count, sizeof(boot_count));
+	flash_maintenance_write_end(sizeof(boot_count));
+
+	if (rc != 0) {
+		LOG_ERR("Boot count save failed: %d", rc);
+	}
+
+	LOG_INF("Boot %d, reset cause 0x%x", boot_count, reset_cause);
+}
+
+void telemetry_count(enum telemetry_counter_t counter)
+{
+	k_spinlock_key_t key;
+
+	if (counter >= TELEMETRY_COUNTER_COUNT) {
+		return;
+	}
+
+	key = k_spin_lock(&telemetry_lock);
+
+	if (counters[counter] < UINT16_MAX) {
+		++counters[counter];
+	}
+
+	k_spin_unlock(&telemetry_lock, key);
+}
+
+void telemetry_voltage(uint16_t voltage)
+{
+	k_spinlock_key_t key = k_spin_lock(&telemetry_lock);
+
+	if (voltage < min_voltage) {
+		min_voltage = voltage;
+	}
+
+	k_spin_unlock(&telemetry_lock, key);
+}
+
+uint8_t telemetry_encode(uint8_t *data)
+{
+	uint8_t size;
+	struct lora_status_t lora_status;
+	uint32_t flash_erases = UINT32_MAX;
+	uint16_t flash_write_amplification = TELEMETRY_UNKNOWN;
+	uint16_t main_stack_unused = telemetry_stack_unused(k_current_get());
+	uint16_t workqueue_stack_unused = telemetry_stack_unused(&k_sys_work_q.thread);
+	k_spinlock_key_t key;
+
+#ifdef CONFIG_APP_FLASH_MAINTENANCE
+	struct flash_maintenance_stats_t flash_stats;
+
+	if (flash_maintenance_get_stats(&flash_stats) == 0) {
+		flash_erases = flash_stats.erases;
+		flash_write_amplification = flash_stats.write_amplification;
+	}
+#endif
+
+	lora_get_status(&lora_status);
+	key = k_spin_lock(&telemetry_lock);
+
+	size = payload_uplink_telemetry_encode(data, (uint32_t)(k_uptime_get() / MSEC_PER_SEC),
+					       reset_cause, boot_count,
+					       counters[TELEMETRY_COUNTER_SEND_FAILURES],
+					       counters[TELEMETRY_COUNTER_SEND_RETRIES],
+					       counters[TELEMETRY_COUNTER_JOIN_ATTEMPTS],
+					       lora_status.rssi, lora_status.snr,
+					       uplink_queue_get_drops(), min_voltage, main_stack_unused,
+					       workqueue_stack_unused, flash_erases,
+					       flash_write_amplification);
+
+	k_spin_unlock(&telemetry_lock, key);
+
+	return size;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_TELEMETRY_H
+#define APP_TELEMETRY_H
+
+#include <zephyr/kernel.h>
+
+enum telemetry_counter_t {
+	/* Uplinks which failed after all attempts */
+	TELEMETRY_COUNTER_SEND_FAILURES,
+	/* Uplink attempts which failed and were retried */
+	TELEMETRY_COUNTER_SEND_RETRIES,
+	TELEMETRY_COUNTER_JOIN_ATTEMPTS,
+
+	TELEMETRY_COUNTER_COUNT
+};
+
+#ifdef CONFIG_APP_TELEMETRY
+/* Setup telemetry, reads the reset cause and increments the persistent boot count, must be
+ * called after settings have been initialised
+ */
+void telemetry_init(void);
+
+/* Increment a counter, counters saturate */
+void telemetry_count(enum telemetry_counter_t counter);
+
+/* Record a battery voltage reading (in mV) */
+void telemetry_voltage(uint16_t voltage);
+
+/* Encode a telemetry uplink, data must be at least PAYLOAD_UPLINK_TELEMETRY_SIZE bytes, returns
+ * size
+ */
+uint8_t telemetry_encode(uint8_t *data);
+#else
+static inline void telemetry_count(enum telemetry_counter_t counter)
+{
+}
+
+static inline void telemetry_voltage(uint16_t voltage)
+{
+}
+#endif
+
+#endif /* APP_TELEMETRY_H */
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "trace.h"
+
+LOG_MODULE_REGISTER(trace, CONFIG_APP_TRACE_LOG_LEVEL);
+
+static const char *const point_names[TRACE_POINT_COUNT] = {
+	[TRACE_POINT_WAKE] = "wake",
+	[TRACE_POINT_HFCLK_ENABLE] = "hfclk",
+	[TRACE_POINT_SENSOR_FETCH] = "sensor",
+	[TRACE_POINT_ADC_READ] = "adc",
+	[TRACE_POINT_LORA_SEND] = "lora tx",
+	[TRACE_POINT_DOWNLINK] = "downlink",
+	[TRACE_POINT_IR_LED_SEND] = "ir led",
+	[TRACE_POINT_FLASH_GC] = "flash gc",
+};
+
+static struct trace_event_t events_buffer[CONFIG_APP_TRACE_EVENTS];
+/* Index of the oldest event */
+static uint16_t events_head = 0;
+static uint16_t events_count = 0;
+static uint32_t events_lost = 0;
+static struct k_spinlock trace_lock;
+
+void trace_record(enum trace_point_t point, enum trace_kind_t kind, int result)
+{
+	struct trace_event_t *event;
+	uint32_t cycles = k_cycle_get_32();
+	k_spinlock_key_t key = k_spin_lock(&trace_lock);
+
+	if (events_count < CONFIG_APP_TRACE_EVENTS) {
+		event = &events_buffer[(events_head + events_count) % CONFIG_APP_TRACE_EVENTS];
+		++events_count;
+	} else {
+		event = &events_buffer[events_head];
+		events_head = (events_head + 1) % CONFIG_APP_TRACE_EVENTS;
+		++events_lost;
+	}
+
+	event->cycles = cycles;
+	event->point = point;
+	event->kind = kind;
+	event->result = (int16_t)CLAMP(result, INT16_MIN, INT16_MAX);
+
+	k_spin_unlock(&trace_lock, key);
+}
+
+uint16_t trace_count(void)
+{
+	return events_count;
+}
+
+uint32_t trace_lost(void)
+{
+	return events_lost;
+}
+
+uint16_t trace_read(uint16_t offset, struct trace_event_t *events, uint16_t count)
+{
+	uint16_t i = 0;
+	k_spinlock_key_t key = k_spin_lock(&trace_lock);
+
+	while (i < count && (offset + i) < events_count) {
+		events[i] = events_buffer[(events_head + offset + i) % CONFIG_APP_TRACE_EVENTS];
+		++i;
+	}
+
+	k_spin_unlock(&trace_lock, key);
+
+	return i;
+}
+
+void trace_clear(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&trace_lock);
+
+	events_head = 0;
+	events_count = 0;
+	events_lost = 0;
+
+	k_spin_unlock(&trace_lock, key);
+
+	LOG_DBG("Trace cleared");
+}
+
+const char *trace_point_name(enum trace_point_t point)
+{
+	if (point >= TRACE_POINT_COUNT) {
+		return "unknown";
+	}
+
+	return point_names[point];
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_TRACE_H
+#define APP_TRACE_H
+
+#include <zephyr/kernel.h>
+
+enum trace_point_t {
+	TRACE_POINT_WAKE,
+	TRACE_POINT_HFCLK_ENABLE,
+	TRACE_POINT_SENSOR_FETCH,
+	TRACE_POINT_ADC_READ,
+	TRACE_POINT_LORA_SEND,
+	TRACE_POINT_DOWNLINK,
+	TRACE_POINT_IR_LED_SEND,
+	TRACE_POINT_FLASH_GC,
+
+	TRACE_POINT_COUNT
+};
+
+enum trace_kind_t {
+	TRACE_KIND_ENTER,
+	TRACE_KIND_EXIT,
+};
+
+struct trace_event_t {
+	/* Hardware cycle counter when the event was recorded */
+	uint32_t cycles;
+	uint8_t point;
+	uint8_t kind;
+	/* Result code for exit events, clamped to 16 bits */
+	int16_t result;
+};
+
+#ifdef CONFIG_APP_TRACE
+/* Record an event in the trace buffer, overwriting the oldest event if it is full */
+void trace_record(enum trace_point_t point, enum trace_kind_t kind, int result);
+
+/* Get number of events in the trace buffer */
+uint16_t trace_count(void);
+
+/* Get number of events which have been overwritten since the buffer was cleared */
+uint32_t trace_lost(void);
+
+/* Copy up to count events (oldest first) starting at offset, returns number copied */
+uint16_t trace_read(uint16_t offset, struct trace_event_t *events, uint16_t count);
+
+/* Remove all events from the trace buffer */
+void trace_clear(void);
+
+/* Get name of a trace point */
+const char *trace_point_name(enum trace_point_t point);
+#else
+static inline void trace_record(enum trace_point_t point, enum trace_kind_t kind, int result)
+{
+}
+#endif
+
+static inline void trace_enter(enum trace_point_t point)
+{
+	trace_record(point, TRACE_KIND_ENTER, 0);
+}
+
+static inline void trace_exit(enum trace_point_t point, int result)
+{
+	trace_record(point, TRACE_KIND_EXIT, result);
+}
+
+#endif /* APP_TRACE_H */
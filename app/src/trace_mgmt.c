@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/mgmt/mcumgr/mgmt/mgmt.h>
+#include <zephyr/mgmt/mcumgr/mgmt/handlers.h>
+#include <zephyr/mgmt/mcumgr/smp/smp.h>
+#include <zcbor_common.h>
+#include <zcbor_encode.h>
+#include <zcbor_decode.h>
+
+#include <mgmt/mcumgr/util/zcbor_bulk.h>
+
+#include "trace.h"
+
+/*
+ * Trace MCUmgr group, read (command 0) takes an optional "off" event offset and returns "total"
+ * (events in the buffer), "lost" (events overwritten), "off" and "ev" which is a byte string of
+ * up to CONFIG_APP_TRACE_MCUMGR_EVENTS events, oldest first, each packed as timestamp in us
+ * (u32le), trace point (u8), kind (u8, 0 = enter, 1 = exit) and result (s16le). Clear (command
+ * 1, write) empties the buffer.
+ */
+#define TRACE_MGMT_ID_READ 0
+#define TRACE_MGMT_ID_CLEAR 1
+
+#define TRACE_MGMT_EVENT_SIZE 8
+
+static int trace_mgmt_read(struct smp_streamer *ctxt)
+{
+	zcbor_state_t *zse = ctxt->writer->zs;
+	zcbor_state_t *zsd = ctxt->reader->zs;
+	struct trace_event_t events[CONFIG_APP_TRACE_MCUMGR_EVENTS];
+	uint8_t packed[CONFIG_APP_TRACE_MCUMGR_EVENTS * TRACE_MGMT_EVENT_SIZE];
+	uint32_t offset = 0;
+	uint16_t count;
+	uint16_t i = 0;
+	size_t decoded;
+	bool ok;
+	struct zcbor_map_decode_key_val trace_read_decode[] = {
+		ZCBOR_MAP_DECODE_KEY_DECODER("off", zcbor_uint32_decode, &offset),
+	};
+
+	if (zcbor_map_decode_bulk(zsd, trace_read_decode, ARRAY_SIZE(trace_read_decode),
+				  &decoded) != 0 || offset > UINT16_MAX) {
+		return MGMT_ERR_EINVAL;
+	}
+
+	count = trace_read((uint16_t)offset, events, ARRAY_SIZE(events));
+
+	while (i < count) {
+		uint8_t *data = &packed[i * TRACE_MGMT_EVENT_SIZE];
+
+		sys_put_le32(k_cyc_to_us_floor32(events[i].cycles), &data[0]);
+		data[4] = events[i].point;
+		data[5] = events[i].kind;
+		sys_put_le16((uint16_t)events[i].result, &data[6]);
+		++i;
+	}
+
+	ok = zcbor_tstr_put_lit(zse, "total") && zcbor_uint32_put(zse, trace_count()) &&
+	     zcbor_tstr_put_lit(zse, "lost") && zcbor_uint32_put(zse, trace_lost()) &&
+	     zcbor_tstr_put_lit(zse, "off") && zcbor_uint32_put(zse, offset) &&
+	     zcbor_tstr_put_lit(zse, "ev") &&
+	     zcbor_bstr_encode_ptr(zse, packed, (count * TRACE_MGMT_EVENT_SIZE));
+
+	return ok ? MGMT_ERR_EOK : MGMT_ERR_EMSGSIZE;
+}
+
+static int trace_mgmt_clear(struct smp_streamer *ctxt)
+{
+	trace_clear();
+
+	return MGMT_ERR_EOK;
+}
+
+static const struct mgmt_handler trace_mgmt_handlers[] = {
+	[TRACE_MGMT_ID_READ] = {
+		.mh_read = trace_mgmt_read,
+		.mh_write = NULL,
+	},
+	[TRACE_MGMT_ID_CLEAR] = {
+		.mh_read = NULL,
+		.mh_write = trace_mgmt_clear,
+	},
+};
+
+static struct mgmt_group trace_mgmt_group = {
+	.mg_handlers = trace_mgmt_handlers,
+	.mg_handlers_count = ARRAY_SIZE(trace_mgmt_handlers),
+	.mg_group_id = CONFIG_APP_TRACE_MCUMGR_GROUP_ID,
+};
+
+static void trace_mgmt_register_group(void)
+{
+	mgmt_register_group(&trace_mgmt_group);
+}
+
+MCUMGR_HANDLER_DEFINE(trace_mgmt, trace_mgmt_register_group);
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "uplink_queue.h"
+#include "lora.h"
+
+LOG_MODULE_REGISTER(uplink_queue, CONFIG_APP_UPLINK_QUEUE_LOG_LEVEL);
+
+extern void lora_message_added(void);
+
+K_HEAP_DEFINE(uplink_queue_pool, CONFIG_APP_UPLINK_QUEUE_SIZE);
+
+static sys_slist_t uplink_queue = SYS_SLIST_STATIC_INIT(&uplink_queue);
+static struct k_spinlock uplink_queue_lock;
+static uint8_t uplink_queue_count = 0;
+static uint16_t uplink_queue_drops = 0;
+
+/* Must be called with the lock held, returns removed entry which must be freed */
+static struct uplink_queue_entry_t *uplink_queue_evict(uint8_t priority)
+{
+	struct uplink_queue_entry_t *entry;
+	struct uplink_queue_entry_t *evict = NULL;
+	sys_snode_t *evict_prev = NULL;
+	sys_snode_t *prev = NULL;
+
+	/* Queue is ordered by priority, find the last entry with a lower priority */
+	SYS_SLIST_FOR_EACH_CONTAINER(&uplink_queue, entry, node) {
+		if (entry->priority < priority && !(entry->flags & UPLINK_QUEUE_FLAG_IN_FLIGHT)) {
+			evict = entry;
+			evict_prev = prev;
+		}
+
+		prev = &entry->node;
+	}
+
+	if (evict != NULL) {
+		sys_slist_remove(&uplink_queue, evict_prev, &evict->node);
+		--uplink_queue_count;
+	}
+
+	++uplink_queue_drops;
+
+	return evict;
+}
+
+int uplink_queue_add(uint8_t port, enum uplink_queue_priority_t priority, uint8_t flags,
+		     const uint8_t *data, uint8_t data_size)
+{
+	struct uplink_queue_entry_t *entry;
+	struct uplink_queue_entry_t *current;
+	sys_snode_t *prev = NULL;
+	k_spinlock_key_t key;
+
+	if (data_size > LORA_MAX_PAYLOAD_SIZE || priority >= UPLINK_QUEUE_PRIORITY_COUNT) {
+		return -EINVAL;
+	}
+
+	while (1) {
+		entry = k_heap_alloc(&uplink_queue_pool, sizeof(*entry) + data_size, K_NO_WAIT);
+
+		if (entry != NULL) {
+			break;
+		}
+
+		key = k_spin_lock(&uplink_queue_lock);
+		current = uplink_queue_evict(priority);
+		k_spin_unlock(&uplink_queue_lock, key);
+
+		if (current == NULL) {
+			LOG_WRN("Uplink queue full, message dropped");
+			return -ENOMEM;
+		}
+
+		LOG_WRN("Uplink queue full, lower priority message dropped");
+		k_heap_free(&uplink_queue_pool, current);
+	}
+
+	entry->port = port;
+	entry->priority = priority;
+	entry->flags = flags & ~UPLINK_QUEUE_FLAG_IN_FLIGHT;
+	entry->retries = 0;
+	entry->data_size = data_size;
+
+	if (data_size > 0) {
+		memcpy(entry->data, data, data_size);
+	}
+
+	key = k_spin_lock(&uplink_queue_lock);
+
+	/* Insert after all messages with the same or higher priority */
+	SYS_SLIST_FOR_EACH_CONTAINER(&uplink_queue, current, node) {
+		if (current->priority < priority) {
+			break;
+		}
+
+		prev = &current->node;
+	}
+
+	sys_slist_insert(&uplink_queue, prev, &entry->node);
+	++uplink_queue_count;
+	k_spin_unlock(&uplink_queue_lock, key);
+
+	lora_message_added();
+
+	return 0;
+}
+
+struct uplink_queue_entry_t *uplink_queue_get(void)
+{
+	struct uplink_queue_entry_t *entry;
+	k_spinlock_key_t key = k_spin_lock(&uplink_queue_lock);
+
+	entry = SYS_SLIST_PEEK_HEAD_CONTAINER(&uplink_queue, entry, node);
+
+	if (entry != NULL) {
+		entry->flags |= UPLINK_QUEUE_FLAG_IN_FLIGHT;
+	}
+
+	k_spin_unlock(&uplink_queue_lock, key);
+
+	return entry;
+}
+
+struct uplink_queue_entry_t *uplink_queue_get_fitting(uint8_t port, uint8_t max_size)
+{
+	struct uplink_queue_entry_t *entry;
+	k_spinlock_key_t key = k_spin_lock(&uplink_queue_lock);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&uplink_queue, entry, node) {
+		if (entry->port == port && entry->data_size > 0 && entry->data_size <= max_size &&
+		    !(entry->flags & UPLINK_QUEUE_FLAG_IN_FLIGHT)) {
+			entry->flags |= UPLINK_QUEUE_FLAG_IN_FLIGHT;
+			k_spin_unlock(&uplink_queue_lock, key);
+
+			return entry;
+		}
+	}
+
+	k_spin_unlock(&uplink_queue_lock, key);
+
+	return NULL;
+}
+
+void uplink_queue_remove(struct uplink_queue_entry_t *entry)
+{
+	k_spinlock_key_t key = k_spin_lock(&uplink_queue_lock);
+
+	(void)sys_slist_find_and_remove(&uplink_queue, &entry->node);
+	--uplink_queue_count;
+	k_spin_unlock(&uplink_queue_lock, key);
+
+	k_heap_free(&uplink_queue_pool, entry);
+}
+
+bool uplink_queue_failed(struct uplink_queue_entry_t *entry)
+{
+	k_spinlock_key_t key = k_spin_lock(&uplink_queue_lock);
+
+	entry->flags &= ~UPLINK_QUEUE_FLAG_IN_FLIGHT;
+	++entry->retries;
+
+	if (entry->retries <= CONFIG_APP_UPLINK_QUEUE_MAX_RETRIES) {
+		k_spin_unlock(&uplink_queue_lock, key);
+		return true;
+	}
+
+	(void)sys_slist_find_and_remove(&uplink_queue, &entry->node);
+	--uplink_queue_count;
+	++uplink_queue_drops;
+	k_spin_unlock(&uplink_queue_lock, key);
+
+	LOG_ERR("Uplink message retried too many times, dropped");
+	k_heap_free(&uplink_queue_pool, entry);
+
+	return false;
+}
+
+void uplink_queue_deferred(struct uplink_queue_entry_t *entry)
+{
+	k_spinlock_key_t key = k_spin_lock(&uplink_queue_lock);
+
+	entry->flags &= ~UPLINK_QUEUE_FLAG_IN_FLIGHT;
+	k_spin_unlock(&uplink_queue_lock, key);
+}
+
+uint8_t uplink_queue_get_count(void)
+{
+	return uplink_queue_count;
+}
+
+uint16_t uplink_queue_get_drops(void)
+{
+	return uplink_queue_drops;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef APP_UPLINK_QUEUE_H
+#define APP_UPLINK_QUEUE_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+
+enum uplink_queue_priority_t {
+	UPLINK_QUEUE_PRIORITY_LOW,
+	UPLINK_QUEUE_PRIORITY_NORMAL,
+	UPLINK_QUEUE_PRIORITY_HIGH,
+
+	UPLINK_QUEUE_PRIORITY_COUNT,
+};
+
+enum uplink_queue_flags_t {
+	UPLINK_QUEUE_FLAG_CONFIRMED = BIT(0),
+
+	/* Internal, set whilst the entry is being sent */
+	UPLINK_QUEUE_FLAG_IN_FLIGHT = BIT(7),
+};
+
+struct uplink_queue_entry_t {
+	sys_snode_t node;
+	uint8_t port;
+	uint8_t priority;
+	uint8_t flags;
+	uint8_t retries;
+	uint8_t data_size;
+	uint8_t data[];
+};
+
+/* Add a message to the queue, if the queue is full then a lower priority message will be dropped
+ * to make space, if there is none then this message is dropped
+ */
+int uplink_queue_add(uint8_t port, enum uplink_queue_priority_t priority, uint8_t flags,
+		     const uint8_t *data, uint8_t data_size);
+
+/* Get the highest priority message in the queue without removing it, must be followed by either
+ * uplink_queue_remove() or uplink_queue_failed()
+ */
+struct uplink_queue_entry_t *uplink_queue_get(void);
+
+/* Get the highest priority message for a port which is not already being sent and has a size
+ * between 1 and max_size, must be followed by either uplink_queue_remove(),
+ * uplink_queue_failed() or uplink_queue_deferred()
+ */
+struct uplink_queue_entry_t *uplink_queue_get_fitting(uint8_t port, uint8_t max_size);
+
+/* Remove a message from the queue after it has been sent */
+void uplink_queue_remove(struct uplink_queue_entry_t *entry);
+
+/* Mark a message as having failed to send, the message is dropped if it has been retried too many
+ * times. Returns true if the message is still queued
+ */
+bool uplink_queue_failed(struct uplink_queue_entry_t *entry);
+
+/* Return a message to the queue without counting a retry (e.g. if sending was deferred) */
+void uplink_queue_deferred(struct uplink_queue_entry_t *entry);
+
+/* Get number of queued messages */
+uint8_t uplink_queue_get_count(void);
+
+/* Get total number of messages that have been dropped */
+uint16_t uplink_queue_get_drops(void);
+
+#endif /* APP_UPLINK_QUEUE_H */
@@ -7,6 +7,7 @@
 #ifndef APP_WATCHDOG_H
 #define APP_WATCHDOG_H
 
+#ifdef CONFIG_APP_WATCHDOG
 /* Initialise watchdog */
 int watchdog_init(void);
 
@@ -15,5 +16,14 @@ void watchdog_feed(void);
 
 /* Mark fatal error (stop feeding watchdog) */
 void watchdog_fatal(void);
+#else
+static inline void watchdog_feed(void)
+{
+}
+
+static inline void watchdog_fatal(void)
+{
+}
+#endif
 
 #endif /* APP_WATCHDOG_H */
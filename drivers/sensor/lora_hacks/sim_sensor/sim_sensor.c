@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2024 Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#define DT_DRV_COMPAT lora_hacks_sim_sensor
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(sim_sensor, CONFIG_SENSOR_LOG_LEVEL);
+
+struct sim_sensor_config {
+	int32_t temperature;
+	int32_t humidity;
+	int32_t temperature_swing;
+	int32_t humidity_swing;
+	uint32_t period;
+};
+
+struct sim_sensor_data {
+	uint32_t fetches;
+	int32_t temperature;
+	int32_t humidity;
+};
+
+/* Position on a triangle wave going from -swing to +swing and back over period steps */
+static int32_t sim_sensor_triangle(uint32_t step, uint32_t period, int32_t swing)
+{
+	uint32_t half = period / 2;
+	uint32_t position;
+
+	if (half == 0) {
+		return 0;
+	}
+
+	position = step % period;
+
+	if (position >= half) {
+		position = period - position;
+	}
+
+	return -swing + (int32_t)(((int64_t)swing * 2 * position) / half);
+}
+
+static void sim_sensor_milli_to_value(int32_t milli, struct sensor_value *val)
+{
+	val->val1 = milli / 1000;
+	val->val2 = (milli % 1000) * 1000;
+}
+
+static int sim_sensor_sample_fetch(const struct device *dev, enum sensor_channel chan)
+{
+	const struct sim_sensor_config *cfg = dev->config;
+	struct sim_sensor_data *drv_data = dev->data;
+
+	if (chan != SENSOR_CHAN_ALL) {
+		return -ENOTSUP;
+	}
+
+	drv_data->temperature = cfg->temperature +
+				sim_sensor_triangle(drv_data->fetches, cfg->period,
+						    cfg->temperature_swing);
+	drv_data->humidity = cfg->humidity +
+			     sim_sensor_triangle(drv_data->fetches, cfg->period,
+						 cfg->humidity_swing);
+	++drv_data->fetches;
+
+	return 0;
+}
+
+static int sim_sensor_channel_get(const struct device *dev, enum sensor_channel chan,
+				  struct sensor_value *val)
+{
+	struct sim_sensor_data *drv_data = dev->data;
+
+	if (chan == SENSOR_CHAN_AMBIENT_TEMP) {
+		sim_sensor_milli_to_value(drv_data->temperature, val);
+	} else if (chan == SENSOR_CHAN_HUMIDITY) {
+		sim_sensor_milli_to_value(drv_data->humidity, val);
+	} else {
+		return -ENOTSUP;
+	}
+
+	return 0;
+}
+
+static const struct sensor_driver_api sim_sensor_api = {
+	.sample_fetch = &sim_sensor_sample_fetch,
+	.channel_get = &sim_sensor_channel_get,
+};
+
+static int sim_sensor_init(const struct device *dev)
+{
+	const struct sim_sensor_config *cfg = dev->config;
+	struct sim_sensor_data *drv_data = dev->data;
+
+	drv_data->temperature = cfg->temperature;
+	drv_data->humidity = cfg->humidity;
+
+	return 0;
+}
+
+#define SIM_SENSOR_DEFINE(inst)								\
+	static struct sim_sensor_data sim_sensor_data_##inst;				\
+											\
+	static const struct sim_sensor_config sim_sensor_config_##inst = {		\
+		.temperature = DT_INST_PROP(inst, temperature_milli_celsius),		\
+		.humidity = DT_INST_PROP(inst, humidity_milli_percent),			\
+		.temperature_swing = DT_INST_PROP(inst, temperature_swing_milli_celsius),\
+		.humidity_swing = DT_INST_PROP(inst, humidity_swing_milli_percent),	\
+		.period = DT_INST_PROP(inst, period),					\
+	};										\
+											\
+	SENSOR_DEVICE_DT_INST_DEFINE(inst, &sim_sensor_init, NULL,			\
+				     &sim_sensor_data_##inst, &sim_sensor_config_##inst,\
+				     POST_KERNEL, CONFIG_SENSOR_INIT_PRIORITY,		\
+				     &sim_sensor_api);
+
+DT_INST_FOREACH_STATUS_OKAY(SIM_SENSOR_DEFINE)
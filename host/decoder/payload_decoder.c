@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <errno.h>
+#include "payload_decoder.h"
+#include "readings_codec.h"
+
+/* Size of each record header in a multiple message: type and length */
+#define MULTIPLE_RECORD_HEADER_SIZE 2
+
+static const uint8_t format_sizes[] = {
+	[PAYLOAD_FORMAT_U8] = 1,
+	[PAYLOAD_FORMAT_S8] = 1,
+	[PAYLOAD_FORMAT_U16LE] = 2,
+	[PAYLOAD_FORMAT_U16BE] = 2,
+	[PAYLOAD_FORMAT_S16LE] = 2,
+	[PAYLOAD_FORMAT_S16BE] = 2,
+	[PAYLOAD_FORMAT_U32LE] = 4,
+	[PAYLOAD_FORMAT_U32BE] = 4,
+};
+
+static int64_t read_field(uint8_t format, const uint8_t *data)
+{
+	switch (format) {
+	case PAYLOAD_FORMAT_U8:
+		return data[0];
+	case PAYLOAD_FORMAT_S8:
+		return (int8_t)data[0];
+	case PAYLOAD_FORMAT_U16LE:
+		return (uint16_t)(data[0] | (data[1] << 8));
+	case PAYLOAD_FORMAT_U16BE:
+		return (uint16_t)((data[0] << 8) | data[1]);
+	case PAYLOAD_FORMAT_S16LE:
+		return (int16_t)(data[0] | (data[1] << 8));
+	case PAYLOAD_FORMAT_S16BE:
+		return (int16_t)((data[0] << 8) | data[1]);
+	case PAYLOAD_FORMAT_U32LE:
+		return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) |
+		       ((uint32_t)data[3] << 24);
+	case PAYLOAD_FORMAT_U32BE:
+		return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
+		       ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+	default:
+		return 0;
+	}
+}
+
+/* Decode the fields of a type, returns number of bytes used or negative error code */
+static int decode_fields(const struct payload_type *type, const uint8_t *data, size_t size,
+			 const struct payload_visitor *visitor, void *context, int64_t *last)
+{
+	size_t pos = 0;
+	uint8_t i = 0;
+
+	while (i < type->field_count) {
+		const struct payload_field *field = &type->fields[i];
+		uint8_t field_size = format_sizes[field->format];
+
+		if ((pos + field_size) > size) {
+			if (pos == size && field->since > 0) {
+				/* Optional field not sent by older devices */
+				break;
+			}
+
+			return -EMSGSIZE;
+		}
+
+		*last = read_field(field->format, &data[pos]);
+
+		if (visitor->field != NULL) {
+			visitor->field(context, field, *last);
+		}
+
+		pos += field_size;
+		++i;
+	}
+
+	return pos;
+}
+
+static int decode_type(const struct payload_type *type, const struct payload_type *const *types,
+		       uint8_t type_count, const uint8_t *data, size_t size,
+		       const struct payload_visitor *visitor, void *context, uint8_t depth);
+
+static int decode_records(const struct payload_type *record, const uint8_t *data, size_t size,
+			  const struct payload_visitor *visitor, void *context, uint8_t depth)
+{
+	size_t pos = 0;
+	int64_t last;
+
+	while (pos < size) {
+		int rc;
+
+		if (visitor->begin != NULL) {
+			visitor->begin(context, record, depth);
+		}
+
+		rc = decode_fields(record, &data[pos], (size - pos), visitor, context, &last);
+
+		if (rc < 0) {
+			return rc;
+		}
+
+		if (visitor->end != NULL) {
+			visitor->end(context, record, depth);
+		}
+
+		pos += rc;
+	}
+
+	return 0;
+}
+
+static int decode_compact_readings(const struct payload_type *record, const uint8_t *data,
+				   size_t size, const struct payload_visitor *visitor,
+				   void *context, uint8_t depth)
+{
+	struct readings_codec_t codec;
+	struct reading_t reading;
+	size_t pos = 0;
+
+	if (record->field_count != 5) {
+		return -EINVAL;
+	}
+
+	readings_codec_reset(&codec);
+
+	while (pos < size) {
+		int rc = readings_codec_decode(&codec, &data[pos],
+					       (size - pos) > UINT8_MAX ? UINT8_MAX : (size - pos),
+					       &reading);
+
+		if (rc < 0) {
+			return -EMSGSIZE;
+		}
+
+		if (visitor->begin != NULL) {
+			visitor->begin(context, record, depth);
+		}
+
+		if (visitor->field != NULL) {
+			visitor->field(context, &record->fields[0], reading.temperature[0]);
+			visitor->field(context, &record->fields[1], reading.temperature[1]);
+			visitor->field(context, &record->fields[2], reading.humidity[0]);
+			visitor->field(context, &record->fields[3], reading.humidity[1]);
+			visitor->field(context, &record->fields[4], reading.voltage);
+		}
+
+		if (visitor->end != NULL) {
+			visitor->end(context, record, depth);
+		}
+
+		pos += rc;
+	}
+
+	return 0;
+}
+
+static int decode_multiple(const struct payload_type *const *types, uint8_t type_count,
+			   const uint8_t *data, size_t size, const struct payload_visitor *visitor,
+			   void *context, uint8_t depth)
+{
+	size_t pos = 0;
+
+	while (pos < size) {
+		uint8_t id;
+		uint8_t record_size;
+		int rc;
+
+		if ((pos + MULTIPLE_RECORD_HEADER_SIZE) > size) {
+			return -EMSGSIZE;
+		}
+
+		id = data[pos];
+		record_size = data[pos + 1];
+		pos += MULTIPLE_RECORD_HEADER_SIZE;
+
+		if (record_size > (size - pos)) {
+			return -EMSGSIZE;
+		} else if (id >= type_count || types[id]->tail == PAYLOAD_TAIL_MULTIPLE) {
+			return -EINVAL;
+		}
+
+		rc = decode_type(types[id], types, type_count, &data[pos], record_size, visitor,
+				 context, depth);
+
+		if (rc < 0) {
+			return rc;
+		}
+
+		pos += record_size;
+	}
+
+	return 0;
+}
+
+/* Decode a type (data excludes the type byte) */
+static int decode_type(const struct payload_type *type, const struct payload_type *const *types,
+		       uint8_t type_count, const uint8_t *data, size_t size,
+		       const struct payload_visitor *visitor, void *context, uint8_t depth)
+{
+	int rc;
+	int64_t last = 0;
+
+	if (visitor->begin != NULL) {
+		visitor->begin(context, type, depth);
+	}
+
+	rc = decode_fields(type, data, size, visitor, context, &last);
+
+	if (rc < 0) {
+		return rc;
+	}
+
+	data += rc;
+	size -= rc;
+
+	switch (type->tail) {
+	case PAYLOAD_TAIL_NONE:
+		rc = (size == 0 ? 0 : -EMSGSIZE);
+		break;
+	case PAYLOAD_TAIL_RECORDS:
+		rc = decode_records(type->record, data, size, visitor, context, (depth + 1));
+		break;
+	case PAYLOAD_TAIL_COMPACT_READINGS:
+		rc = decode_compact_readings(type->record, data, size, visitor, context,
+					     (depth + 1));
+		break;
+	case PAYLOAD_TAIL_MULTIPLE:
+		rc = decode_multiple(types, type_count, data, size, visitor, context, (depth + 1));
+		break;
+	case PAYLOAD_TAIL_SELECT:
+		if (type->field_count == 0 || last < 0 || last >= type->subtype_count) {
+			return -EINVAL;
+		}
+
+		rc = decode_type(type->subtypes[last], NULL, 0, data, size, visitor, context,
+				 (depth + 1));
+		break;
+	case PAYLOAD_TAIL_BYTES:
+		if (visitor->bytes != NULL) {
+			visitor->bytes(context, data, size);
+		}
+
+		rc = 0;
+		break;
+	default:
+		rc = -EINVAL;
+	}
+
+	if (rc == 0 && visitor->end != NULL) {
+		visitor->end(context, type, depth);
+	}
+
+	return rc;
+}
+
+static int decode(const struct payload_type *const *types, uint8_t type_count,
+		  const uint8_t *data, size_t size, const struct payload_visitor *visitor,
+		  void *context)
+{
+	if (size == 0) {
+		return -EMSGSIZE;
+	} else if (data[0] >= type_count) {
+		return -EINVAL;
+	}
+
+	return decode_type(types[data[0]], types, type_count, &data[1], (size - 1), visitor,
+			   context, 0);
+}
+
+int payload_check_version(uint8_t version)
+{
+	if (version < payload_schema.compatible_since || version > payload_schema.version) {
+		return -ENOTSUP;
+	}
+
+	return 0;
+}
+
+int payload_decode_uplink(const uint8_t *data, size_t size, const struct payload_visitor *visitor,
+			  void *context)
+{
+	return decode(payload_schema.uplinks, payload_schema.uplink_count, data, size, visitor,
+		      context);
+}
+
+int payload_decode_downlink(const uint8_t *data, size_t size,
+			    const struct payload_visitor *visitor, void *context)
+{
+	return decode(payload_schema.downlinks, payload_schema.downlink_count, data, size, visitor,
+		      context);
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#ifndef PAYLOAD_DECODER_H
+#define PAYLOAD_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Table driven decoder for application payloads (LoRa port 1), the tables are generated from
+ * app/schema/payloads.yaml. Decoding does not allocate memory, each decoded message, record
+ * and field is passed to the callbacks of a visitor.
+ */
+
+enum payload_format {
+	PAYLOAD_FORMAT_U8,
+	PAYLOAD_FORMAT_S8,
+	PAYLOAD_FORMAT_U16LE,
+	PAYLOAD_FORMAT_U16BE,
+	PAYLOAD_FORMAT_S16LE,
+	PAYLOAD_FORMAT_S16BE,
+	PAYLOAD_FORMAT_U32LE,
+	PAYLOAD_FORMAT_U32BE,
+};
+
+enum payload_tail {
+	/* No data after the fields */
+	PAYLOAD_TAIL_NONE,
+	/* Repeated records until the end of the payload */
+	PAYLOAD_TAIL_RECORDS,
+	/* Readings encoded with the compact delta codec */
+	PAYLOAD_TAIL_COMPACT_READINGS,
+	/* Repeated type, length and data records of other messages */
+	PAYLOAD_TAIL_MULTIPLE,
+	/* Data selected from the subtypes by the value of the last field */
+	PAYLOAD_TAIL_SELECT,
+	/* Raw data until the end of the payload */
+	PAYLOAD_TAIL_BYTES,
+};
+
+struct payload_field {
+	const char *name;
+	uint8_t format;
+	/* Schema version the field was added in, 0 if it has always been present. Fields which
+	 * have been added are optional as older devices do not send them
+	 */
+	uint8_t since;
+};
+
+struct payload_type {
+	uint8_t id;
+	const char *name;
+	const struct payload_field *fields;
+	uint8_t field_count;
+	uint8_t tail;
+	const struct payload_type *record;
+	const struct payload_type *const *subtypes;
+	uint8_t subtype_count;
+};
+
+struct payload_schema {
+	uint8_t version;
+	uint8_t compatible_since;
+	const struct payload_type *const *uplinks;
+	uint8_t uplink_count;
+	const struct payload_type *const *downlinks;
+	uint8_t downlink_count;
+};
+
+struct payload_visitor {
+	/* Start of a message, record or subtype, depth is 0 for the outer message */
+	void (*begin)(void *context, const struct payload_type *type, uint8_t depth);
+	/* Decoded field */
+	void (*field)(void *context, const struct payload_field *field, int64_t value);
+	/* End of a message, record or subtype */
+	void (*end)(void *context, const struct payload_type *type, uint8_t depth);
+	/* Raw data of a message with a bytes tail */
+	void (*bytes)(void *context, const uint8_t *data, size_t size);
+};
+
+/* Schema the decoder was generated from */
+extern const struct payload_schema payload_schema;
+
+/* Check if payloads from a device with the given schema version (from the startup message,
+ * devices without a schema version use 1) can be decoded, returns 0 if so or -ENOTSUP
+ */
+int payload_check_version(uint8_t version);
+
+/* Decode an uplink, returns 0 on success or a negative error code (-EINVAL for an unknown
+ * type, -EMSGSIZE for a truncated or oversized payload)
+ */
+int payload_decode_uplink(const uint8_t *data, size_t size, const struct payload_visitor *visitor,
+			  void *context);
+
+/* Decode a downlink, returns 0 on success or a negative error code */
+int payload_decode_downlink(const uint8_t *data, size_t size,
+			    const struct payload_visitor *visitor, void *context);
+
+#endif /* PAYLOAD_DECODER_H */
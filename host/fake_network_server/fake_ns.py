@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024, Jamie M.
+#
+# All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+#
+# Scripted fake LoRaWAN network server for the native_sim build (app/src/lorawan_sim.c).
+# Replies to joins and uplinks as described by a scenario file and logs every message as a JSON
+# line so that runs can be compared.
+#
+# Usage:
+#   west build -b native_sim app
+#   python3 host/fake_network_server/fake_ns.py --scenario host/fake_network_server/scenarios/lossy.yaml
+#   build/zephyr/zephyr.exe
+
+import argparse
+import json
+import random
+import socket
+import struct
+import sys
+import time
+
+import yaml
+
+MESSAGE_JOIN = 0x01
+MESSAGE_UPLINK = 0x02
+MESSAGE_JOIN_ACCEPT = 0x81
+MESSAGE_UPLINK_RESULT = 0x82
+
+UPLINK_FLAG_CONFIRMED = 0x01
+RESULT_FLAG_ACKED = 0x01
+RESULT_FLAG_DATA_PENDING = 0x02
+
+JOIN_SIZE = 17
+UPLINK_HEADER_SIZE = 16
+
+DEFAULT_SCENARIO = {
+    # Number of join requests to ignore before accepting and the datarate to join at
+    'join': {'ignore': 0, 'datarate': 0},
+    # Link conditions, loss is the probability that an uplink (or its ack) is lost
+    'link': {'rssi': -90, 'snr': 5, 'loss': 0.0, 'datarate': 0, 'seed': 1},
+    # Downlinks, each is sent in reply to the first uplink with a frame counter of at least
+    # "after" (port and hex data)
+    'downlinks': [],
+}
+
+
+class Device:
+    def __init__(self):
+        self.joins = 0
+        self.downlinks = []
+
+
+class FakeNetworkServer:
+    def __init__(self, scenario, log):
+        self.scenario = scenario
+        self.log = log
+        self.devices = {}
+        self.random = random.Random(scenario['link']['seed'])
+
+    def device(self, dev_eui):
+        if dev_eui not in self.devices:
+            device = Device()
+            device.downlinks = [dict(d) for d in self.scenario['downlinks']]
+            self.devices[dev_eui] = device
+
+        return self.devices[dev_eui]
+
+    def record(self, event, **fields):
+        fields = dict(time=round(time.time(), 3), event=event, **fields)
+        self.log.write(json.dumps(fields) + '\n')
+        self.log.flush()
+
+    def join(self, data):
+        dev_eui = data[1:9].hex()
+        device = self.device(dev_eui)
+        device.joins += 1
+        accepted = device.joins > self.scenario['join']['ignore']
+        self.record('join', dev_eui=dev_eui, join_eui=data[9:17].hex(), accepted=accepted)
+
+        if not accepted:
+            return None
+
+        device.downlinks = [dict(d) for d in self.scenario['downlinks']]
+
+        return bytes([MESSAGE_JOIN_ACCEPT, 0, self.scenario['join']['datarate']])
+
+    def uplink(self, data):
+        dev_eui = data[1:9].hex()
+        frame_counter, port, flags, datarate = struct.unpack_from('<IBBB', data, 9)
+        payload = data[UPLINK_HEADER_SIZE:]
+        link = self.scenario['link']
+        device = self.device(dev_eui)
+        lost = self.random.random() < link['loss']
+        confirmed = bool(flags & UPLINK_FLAG_CONFIRMED)
+
+        self.record('uplink', dev_eui=dev_eui, frame_counter=frame_counter, port=port,
+                    confirmed=confirmed, datarate=datarate, size=len(payload),
+                    payload=payload.hex(), lost=lost)
+
+        if lost:
+            return None
+
+        pending = [d for d in device.downlinks if frame_counter >= d.get('after', 0)]
+        result_flags = RESULT_FLAG_ACKED if confirmed else 0
+        downlink_port = 0
+        downlink_data = b''
+
+        if pending:
+            downlink = pending[0]
+            device.downlinks.remove(downlink)
+            downlink_port = downlink['port']
+            downlink_data = bytes.fromhex(downlink['data'])
+
+            if len(pending) > 1:
+                result_flags |= RESULT_FLAG_DATA_PENDING
+
+            self.record('downlink', dev_eui=dev_eui, port=downlink_port,
+                        payload=downlink_data.hex())
+
+        return struct.pack('<BBBhbB', MESSAGE_UPLINK_RESULT, result_flags, link['datarate'],
+                           link['rssi'], link['snr'], downlink_port) + downlink_data
+
+    def handle(self, data):
+        if len(data) >= JOIN_SIZE and data[0] == MESSAGE_JOIN:
+            return self.join(data)
+        elif len(data) >= UPLINK_HEADER_SIZE and data[0] == MESSAGE_UPLINK:
+            return self.uplink(data)
+
+        self.record('invalid', data=data.hex())
+
+        return None
+
+
+def load_scenario(path):
+    scenario = {key: (dict(value) if isinstance(value, dict) else list(value))
+                for key, value in DEFAULT_SCENARIO.items()}
+
+    if path is None:
+        return scenario
+
+    with open(path, encoding='utf-8') as f:
+        loaded = yaml.safe_load(f) or {}
+
+    for key, value in loaded.items():
+        if key not in scenario:
+            sys.exit(f'fake_ns.py: unknown scenario section "{key}"')
+
+        if isinstance(scenario[key], dict):
+            scenario[key].update(value)
+        else:
+            scenario[key] = list(value)
+
+    return scenario
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Fake LoRaWAN network server for native_sim')
+    parser.add_argument('--scenario', help='scenario file (YAML)')
+    parser.add_argument('--address', default='127.0.0.1', help='address to listen on')
+    parser.add_argument('--port', type=int, default=1680, help='UDP port to listen on')
+    parser.add_argument('--log', help='file to write JSON lines to (default stdout)')
+    args = parser.parse_args()
+
+    log = open(args.log, 'a', encoding='utf-8') if args.log else sys.stdout
+    server = FakeNetworkServer(load_scenario(args.scenario), log)
+
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+        sock.bind((args.address, args.port))
+
+        while True:
+            data, address = sock.recvfrom(512)
+            response = server.handle(data)
+
+            if response is not None:
+                sock.sendto(response, address)
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except KeyboardInterrupt:
+        pass
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2024, Jamie M.
+ *
+ * All right reserved. This code is NOT apache or FOSS/copyleft licensed.
+ */
+
+#include <zephyr/ztest.h>
+#include "readings_codec.h"
+
+#define TEST_TYPE 0x0c
+#define TEST_INTERVAL 300
+#define TEST_READINGS 4
+#define TEST_MAX_SIZE 64
+
+static const struct reading_t test_readings[TEST_READINGS] = {
+	{ .temperature = { 21, 50 }, .humidity = { 45, 10 }, .voltage = 3012 },
+	{ .temperature = { 21, 55 }, .humidity = { 45, 0 }, .voltage = 3011 },
+	/* Large step, needs multi-byte varints */
+	{ .temperature = { -5, -25 }, .humidity = { 90, 99 }, .voltage = 2400 },
+	{ .temperature = { -5, -25 }, .humidity = { 90, 99 }, .voltage = 2400 },
+};
+
+/* Encode test_readings into a compact uplink, returns the size */
+static uint8_t encode_uplink(uint8_t *data, uint8_t max_size)
+{
+	struct readings_codec_t codec;
+	uint8_t size = READINGS_HEADER_SIZE;
+	uint8_t i = 0;
+
+	data[0] = TEST_TYPE;
+	data[1] = (TEST_INTERVAL >> 8) & 0xff;
+	data[2] = TEST_INTERVAL & 0xff;
+	data[3] = TEST_READINGS;
+
+	readings_codec_reset(&codec);
+
+	while (i < TEST_READINGS) {
+		uint8_t entry_size = readings_codec_encode(&codec, &test_readings[i], &data[size],
+							   (max_size - size));
+
+		zassert_not_equal(entry_size, 0, "Reading %d did not fit", i);
+		size += entry_size;
+		++i;
+	}
+
+	return size;
+}
+
+ZTEST(readings_codec, test_round_trip)
+{
+	uint8_t data[TEST_MAX_SIZE];
+	struct reading_t readings[TEST_READINGS];
+	uint16_t interval = 0;
+	uint8_t size = encode_uplink(data, sizeof(data));
+	int rc;
+
+	/* Deltas of repeated readings are a single byte per field */
+	zassert_equal(size, (READINGS_HEADER_SIZE + READINGS_CODEC_KEYFRAME_SIZE + 3 + 6 + 3));
+
+	rc = readings_codec_decode_uplink(data, size, TEST_TYPE, &interval, readings,
+					  ARRAY_SIZE(readings));
+
+	zassert_equal(rc, TEST_READINGS);
+	zassert_equal(interval, TEST_INTERVAL);
+	zassert_mem_equal(readings, test_readings, sizeof(test_readings));
+}
+
+ZTEST(readings_codec, test_size_only)
+{
+	struct readings_codec_t codec;
+	uint8_t data[TEST_MAX_SIZE];
+	uint8_t i = 0;
+
+	readings_codec_reset(&codec);
+
+	/* Size calculation without data must match the encoded size */
+	while (i < TEST_READINGS) {
+		struct readings_codec_t sized = codec;
+
+		zassert_equal(readings_codec_encode(&sized, &test_readings[i], NULL, UINT8_MAX),
+			      readings_codec_encode(&codec, &test_readings[i], data, sizeof(data)));
+		++i;
+	}
+}
+
+ZTEST(readings_codec, test_encode_short_buffer)
+{
+	struct readings_codec_t codec;
+	uint8_t data[TEST_MAX_SIZE];
+
+	readings_codec_reset(&codec);
+	zassert_equal(readings_codec_encode(&codec, &test_readings[0], data,
+					    (READINGS_CODEC_KEYFRAME_SIZE - 1)), 0);
+
+	/* Codec state is unchanged when a reading does not fit */
+	zassert_true(codec.keyframe);
+	zassert_equal(readings_codec_encode(&codec, &test_readings[0], data, sizeof(data)),
+		      READINGS_CODEC_KEYFRAME_SIZE);
+	zassert_equal(readings_codec_encode(&codec, &test_readings[2], data, 2), 0);
+}
+
+ZTEST(readings_codec, test_decode_short_buffer)
+{
+	uint8_t data[TEST_MAX_SIZE];
+	struct reading_t readings[TEST_READINGS];
+	uint16_t interval;
+
+	(void)encode_uplink(data, sizeof(data));
+
+	zassert_equal(readings_codec_decode_uplink(data, (READINGS_HEADER_SIZE - 1), TEST_TYPE,
+						   &interval, readings, ARRAY_SIZE(readings)),
+		      -EINVAL);
+	zassert_equal(readings_codec_decode_uplink(data, sizeof(data), TEST_TYPE, &interval,
+						   readings, (TEST_READINGS - 1)),
+		      -ENOMEM);
+}
+
+ZTEST(readings_codec, test_decode_unknown_type)
+{
+	uint8_t data[TEST_MAX_SIZE];
+	struct reading_t readings[TEST_READINGS];
+	uint16_t interval;
+	uint8_t size = encode_uplink(data, sizeof(data));
+
+	zassert_equal(readings_codec_decode_uplink(data, size, (TEST_TYPE + 1), &interval,
+						   readings, ARRAY_SIZE(readings)),
+		      -ENOTSUP);
+}
+
+ZTEST(readings_codec, test_decode_truncated)
+{
+	uint8_t data[TEST_MAX_SIZE];
+	struct reading_t readings[TEST_READINGS];
+	struct readings_codec_t codec;
+	uint16_t interval;
+	uint8_t size = encode_uplink(data, sizeof(data));
+
+	/* Truncated keyframe */
+	zassert_equal(readings_codec_decode_uplink(data, (READINGS_HEADER_SIZE + 3), TEST_TYPE,
+						   &interval, readings, ARRAY_SIZE(readings)),
+		      -EINVAL);
+
+	/* Last reading missing its final byte */
+	zassert_equal(readings_codec_decode_uplink(data, (size - 1), TEST_TYPE, &interval,
+						   readings, ARRAY_SIZE(readings)),
+		      -EINVAL);
+
+	/* Varint which does not terminate */
+	readings_codec_reset(&codec);
+	codec.keyframe = false;
+	memset(data, 0xff, sizeof(data));
+	zassert_equal(readings_codec_decode(&codec, data, sizeof(data), &readings[0]), -EINVAL);
+}
+
+ZTEST_SUITE(readings_codec, NULL, NULL, NULL, NULL, NULL);